@@ -0,0 +1,158 @@
+#include "Complexity.h"
+#include "Parser.h"
+#include "PrettyPrinter.h"
+#include <cmath>
+
+// Least squares slope of log(seconds) over log(bytes) for the larger half
+// of the points, the small inputs are dominated by fixed costs.
+static double fitExponent(const vector<ComplexityPoint>& points) {
+    double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (size_t i = points.size() / 2 - (points.size() > 2); i < points.size();
+         i++) {
+        const ComplexityPoint& p = points[i];
+        if (p.bytes == 0 || p.seconds <= 0) {
+            continue;
+        }
+        double x = std::log(double(p.bytes));
+        double y = std::log(p.seconds);
+        n++;
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+    double d = n * sxx - sx * sx;
+    return n >= 2 && d != 0 ? (n * sxy - sx * sy) / d : 0;
+}
+
+static string repeat(const string& s, size_t n) {
+    string r;
+    for (size_t i = 0; i < n; i++) {
+        r += s;
+    }
+    return r;
+}
+
+bool ComplexityCheck::axis(Harness& h, const string& name, size_t from,
+                           size_t to,
+                           const std::function<string(size_t)>& generate,
+                           bool broken) {
+    if (only.size() && only != name) {
+        return true;
+    }
+    ComplexityAxis a;
+    a.name = name;
+    for (size_t param = from; param <= to; param *= 2) {
+        string source = generate(param);
+        Parser parser;
+        auto print = [&] {
+            ParseResult result = parser.parse(source);
+            PrettyPrinter printer;
+            result.module->accept(printer);
+            return move(printer.ctx.s);
+        };
+        if (parser.parse(source).ok() == broken) {
+            fprintf(stderr, "%s/%zu: generated input %s\n", name.c_str(),
+                    param, broken ? "parses" : "does not parse");
+            return false;
+        }
+        // Deep nesting prints lines indented by their depth, output growing
+        // quadratically with the input, so time is fitted to both.
+        size_t bytes = source.size() + print().size();
+        const BenchResult& r =
+            h.run(name + "/" + std::to_string(param), source.size(), print);
+        // the fastest run is the least disturbed by noise
+        a.points.push_back({param, bytes, r.min});
+    }
+    a.exponent = fitExponent(a.points);
+    a.superLinear = a.exponent > maxExponent;
+    fprintf(stderr, "%-28s exponent %.2f%s\n", name.c_str(), a.exponent,
+            a.superLinear ? "  SUPER-LINEAR" : "");
+    axes.push_back(a);
+    return true;
+}
+
+bool ComplexityCheck::run(Harness& h) {
+    bool ok =
+        axis(h, "file_length", 16 << 10, 1 << 20,
+             [&](size_t bytes) {
+                 GeneratorOptions o = options;
+                 o.targetBytes = bytes;
+                 return Generator(o).generate();
+             }) &&
+        axis(h, "expression_length", 64, 4096,
+             [&](size_t length) {
+                 GeneratorOptions o = options;
+                 o.exprLength = int(length);
+                 return "x = " + Generator(o).expression() + "\n";
+             }) &&
+        axis(h, "nesting_depth", 8, 256,
+             [&](size_t depth) {
+                 return Generator(options).nestedLoops(int(depth));
+             }) &&
+        axis(h, "chained_comparisons", 64, 4096,
+             [&](size_t length) {
+                 GeneratorOptions o = options;
+                 o.exprLength = 1;
+                 o.compareChain = int(length);
+                 return "x = " + Generator(o).expression() + "\n";
+             }) &&
+        // one BoolOp growing by an operand at a time
+        axis(h, "boolean_chains", 64, 4096, [&](size_t length) {
+            string source = "x = a";
+            for (size_t i = 1; i < length; i++) {
+                source += " and a";
+            }
+            return source + "\n";
+        }) &&
+        // a[a[...]]: each subscript a slice that could still be followed by
+        // a colon
+        axis(h, "bracket_nesting", 32, 1024,
+             [&](size_t depth) {
+                 return "x = " + repeat("a[", depth) + "1" +
+                        repeat("]", depth) + "\n";
+             }) &&
+        // ((a, b), b) = 1: each tuple target first tried as a parenthesized
+        // one
+        axis(h, "tuple_nesting", 32, 1024,
+             [&](size_t depth) {
+                 return repeat("(", depth) + "a" + repeat(", b)", depth) +
+                        " = 1\n";
+             }) &&
+        // x = ((1)): no target, and no parenthesized expression either
+        axis(
+            h, "paren_nesting", 32, 1024,
+            [&](size_t depth) {
+                return "x = " + repeat("(", depth) + "1" + repeat(")", depth) +
+                       "\n";
+            },
+            true);
+    if (!ok) {
+        return false;
+    }
+    for (const ComplexityAxis& a : axes) {
+        if (a.superLinear) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ComplexityCheck::writeJson(FILE* out) const {
+    fprintf(out, "{\n  \"max_exponent\": %.2f,\n  \"axes\": [", maxExponent);
+    for (size_t i = 0; i < axes.size(); i++) {
+        const ComplexityAxis& a = axes[i];
+        fprintf(out,
+                "%s\n    {\"name\": \"%s\", \"exponent\": %.3f, "
+                "\"super_linear\": %s, \"points\": [",
+                i ? "," : "", a.name.c_str(), a.exponent,
+                a.superLinear ? "true" : "false");
+        for (size_t j = 0; j < a.points.size(); j++) {
+            const ComplexityPoint& p = a.points[j];
+            fprintf(out, "%s{\"param\": %zu, \"bytes\": %zu, \"seconds\": %.9f}",
+                    j ? ", " : "", p.param, p.bytes, p.seconds);
+        }
+        fprintf(out, "]}");
+    }
+    fprintf(out, "\n  ]\n}\n");
+}
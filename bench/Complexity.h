@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Generator.h"
+#include "Harness.h"
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+class ComplexityPoint {
+public:
+    // the axis parameter, e.g. the nesting depth
+    size_t param;
+    size_t bytes;
+    double seconds;
+};
+
+class ComplexityAxis {
+public:
+    string name;
+    vector<ComplexityPoint> points;
+    // slope of log(seconds) over log(bytes) at the larger sizes, bytes read
+    // and printed
+    double exponent = 0;
+    bool superLinear = false;
+};
+
+// Tokenizes, parses and prints generated inputs at doubling sizes along
+// several axes and fits how time grows with input size on each. An axis
+// growing faster than `maxExponent` is flagged.
+class ComplexityCheck {
+public:
+    GeneratorOptions options;
+    double maxExponent = 1.25;
+    // only this axis, all when empty
+    string only;
+    vector<ComplexityAxis> axes;
+
+public:
+    // Returns false if any axis is flagged or an input does not parse as
+    // its axis expects.
+    bool run(Harness& h);
+    void writeJson(FILE* out) const;
+
+private:
+    // `broken` axes generate syntax errors, which are timed all the same.
+    bool axis(Harness& h, const string& name, size_t from, size_t to,
+              const std::function<string(size_t)>& generate,
+              bool broken = false);
+};
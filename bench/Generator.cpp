@@ -0,0 +1,206 @@
+#include "Generator.h"
+
+static const char* binaryOperators[] = {
+    " + ", " - ", " * ", " / ", " // ", " % ", " @ ", " << ", " >> ",
+    " | ", " & ", " ^ ", " and ", " or ",
+    // last, so it can be left out
+    " if a else ",
+};
+static const char* augOperators[] = {
+    " += ", " -= ", " *= ", " /= ", " //= ", " %= ", " |= ", " &= ",
+};
+static const char* compareOperators[] = {
+    " == ", " != ", " < ", " <= ", " > ", " >= ", " is ", " is not ", " in ",
+};
+static const char* unaryOperators[] = {"-", "~"};
+
+template <class T, size_t N> constexpr int count(T (&)[N]) { return int(N); }
+
+Generator::Generator(const GeneratorOptions& options)
+    : options(options), state(options.seed) {}
+
+// splitmix64
+uint64_t Generator::random() {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+string Generator::generate() {
+    state = options.seed;
+    out.clear();
+    out.reserve(options.targetBytes + 256);
+    while (out.size() < options.targetBytes) {
+        statement(0);
+    }
+    return move(out);
+}
+
+string Generator::expression() {
+    out.clear();
+    expr(options.exprLength);
+    return move(out);
+}
+
+string Generator::nestedLoops(int depth) {
+    out.clear();
+    for (int d = 0; d < depth; d++) {
+        indent(d);
+        out += "while ";
+        operand();
+        out += ":\n";
+        indent(d + 1);
+        name();
+        out += " = ";
+        operand();
+        out += '\n';
+    }
+    return move(out);
+}
+
+void Generator::statement(int depth) {
+    const StatementMix& m = options.mix;
+    int loops = depth < options.maxDepth ? m.whileLoop : 0;
+    int total = m.assign + m.augAssign + m.annAssign + m.exprStmt + m.import +
+                m.assert_ + loops;
+    if (total > 0 && below(total) < loops) {
+        whileLoop(depth);
+        return;
+    }
+    indent(depth);
+    simpleStatement();
+    out += '\n';
+}
+
+void Generator::simpleStatement() {
+    const StatementMix& m = options.mix;
+    int total = m.assign + m.augAssign + m.annAssign + m.exprStmt + m.import +
+                m.assert_;
+    int pick = total > 0 ? below(total) : 0;
+    if ((pick -= m.assign) < 0 || total == 0) {
+        name();
+        out += " = ";
+        expr(options.exprLength);
+    } else if ((pick -= m.augAssign) < 0) {
+        name();
+        out += augOperators[below(count(augOperators))];
+        expr(options.exprLength);
+    } else if ((pick -= m.annAssign) < 0) {
+        name();
+        out += ": int = ";
+        expr(options.exprLength);
+    } else if ((pick -= m.exprStmt) < 0) {
+        expr(options.exprLength);
+    } else if ((pick -= m.import) < 0) {
+        if (chance(0.5)) {
+            out += "import pkg.mod";
+            out += std::to_string(below(100));
+            out += " as m";
+        } else {
+            out += "from .pkg import a, b as c";
+        }
+    } else {
+        out += "assert ";
+        compare();
+        out += ", 'message'";
+    }
+}
+
+void Generator::whileLoop(int depth) {
+    indent(depth);
+    out += "while ";
+    if (options.compareChain > 0) {
+        compare();
+    } else {
+        // pyser does not take a conditional expression as a loop test
+        expr(options.exprLength, false);
+    }
+    out += ":\n";
+    int n = 1 + below(4);
+    for (int i = 0; i < n; i++) {
+        statement(depth + 1);
+    }
+}
+
+void Generator::expr(int length, bool conditional) {
+    int operators = count(binaryOperators) - (conditional ? 0 : 1);
+    if (options.compareChain > 0) {
+        compare();
+        length--;
+    } else {
+        operand();
+    }
+    for (int i = 0; i < length; i++) {
+        int op = below(operators);
+        out += binaryOperators[op];
+        operand();
+        // pyser groups chained conditionals from the left, keep to one
+        if (op == count(binaryOperators) - 1) {
+            operators--;
+        }
+    }
+}
+
+void Generator::compare() {
+    operand();
+    int n = options.compareChain > 0 ? options.compareChain : 1;
+    for (int i = 0; i < n; i++) {
+        out += compareOperators[below(count(compareOperators))];
+        operand();
+    }
+}
+
+void Generator::operand() {
+    if (chance(0.1)) {
+        out += unaryOperators[below(count(unaryOperators))];
+    }
+    if (chance(options.literalDensity)) {
+        literal();
+        return;
+    }
+    name();
+    switch (below(8)) {
+    case 0:
+        out += ".attr";
+        break;
+    case 1:
+        out += "[";
+        name();
+        out += "]";
+        break;
+    case 2:
+        out += "[1:";
+        name();
+        out += "]";
+        break;
+    }
+}
+
+void Generator::literal() {
+    // no floats, the tokenizer does not lex them yet
+    switch (below(6)) {
+    case 0:
+    case 1:
+    case 2:
+        out += std::to_string(below(100000));
+        break;
+    case 3:
+        out += "'text";
+        out += std::to_string(below(100));
+        out += "'";
+        break;
+    case 4:
+        out += "b\"\\x00bytes\"";
+        break;
+    default:
+        out += chance(0.5) ? "True" : "None";
+        break;
+    }
+}
+
+void Generator::name() {
+    static const char* names[] = {"a",     "b",      "value", "count",
+                                  "total", "result", "x1",    "node"};
+    out += names[below(count(names))];
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+using std::string;
+
+// Relative weights of the statement kinds the generator emits.
+class StatementMix {
+public:
+    int assign = 40;
+    int augAssign = 10;
+    int annAssign = 5;
+    int exprStmt = 10;
+    int whileLoop = 10;
+    int import = 5;
+    int assert_ = 5;
+};
+
+class GeneratorOptions {
+public:
+    uint64_t seed = 1;
+    // output stops at the first statement boundary past this many bytes
+    size_t targetBytes = 1 << 16;
+    StatementMix mix;
+    // deepest nesting of while blocks
+    int maxDepth = 3;
+    // binary operators per expression
+    int exprLength = 4;
+    // chance that an operand is a literal rather than a name, 0..1
+    double literalDensity = 0.3;
+    // comparisons per chained comparison, 0 for none
+    int compareChain = 0;
+};
+
+// Deterministic generator of Python sources within the subset pyser parses.
+// The same options always give the same text.
+class Generator {
+public:
+    Generator(const GeneratorOptions& options);
+
+    string generate();
+    // A single expression of options.exprLength operators.
+    string expression();
+    // While loops nested `depth` deep, each with one assignment.
+    string nestedLoops(int depth);
+
+private:
+    uint64_t random();
+    // uniform in [0, n)
+    int below(int n) { return int(random() % uint64_t(n)); }
+    bool chance(double p) { return double(random() >> 11) * 0x1p-53 < p; }
+
+    void statement(int depth);
+    void simpleStatement();
+    void whileLoop(int depth);
+    void indent(int depth) { out.append(size_t(depth) * 4, ' '); }
+
+    void expr(int length, bool conditional = true);
+    void compare();
+    void operand();
+    void literal();
+    void name();
+
+private:
+    GeneratorOptions options;
+    uint64_t state;
+    string out;
+};
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "AllocStats.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+class BenchResult {
+public:
+    string name;
+    size_t bytes = 0;
+    int reps = 0;
+    double min = 0;
+    double median = 0;
+    double p99 = 0;
+    double mean = 0;
+    // per KB of input and repetition, in builds with PYSER_ALLOC_STATS
+    double allocsPerKb = 0;
+
+    double mbPerSecond() const { return median > 0 ? bytes / median / 1e6 : 0; }
+};
+
+class Harness {
+public:
+    int warmup = 2;
+    int reps = 10;
+    // allocations per input KB a benchmark may make, 0 for no limit
+    double allocBudget = 0;
+    vector<BenchResult> results;
+
+public:
+    // Times `f` over `bytes` of input. Whatever f returns is destroyed
+    // outside the timed region, so freeing an AST does not count as parsing
+    // it.
+    template <class F> const BenchResult& run(const string& name, size_t bytes,
+                                              F&& f) {
+        for (int i = 0; i < warmup; i++) {
+            auto keep = f();
+        }
+        vector<double> samples;
+        AllocCounts before = AllocStats::counts();
+        for (int i = 0; i < reps; i++) {
+            auto start = std::chrono::steady_clock::now();
+            auto keep = f();
+            std::chrono::duration<double> elapsed =
+                std::chrono::steady_clock::now() - start;
+            samples.push_back(elapsed.count());
+        }
+        AllocCounts allocs = AllocStats::counts() - before;
+        std::sort(samples.begin(), samples.end());
+
+        BenchResult r;
+        r.name = name;
+        r.bytes = bytes;
+        r.reps = reps;
+        if (!samples.empty()) {
+            r.min = samples.front();
+            r.median = samples[samples.size() / 2];
+            // nearest rank
+            size_t rank = (samples.size() * 99 + 99) / 100;
+            r.p99 = samples[std::max<size_t>(rank, 1) - 1];
+            for (double s : samples) {
+                r.mean += s;
+            }
+            r.mean /= samples.size();
+        }
+        if (bytes && reps) {
+            r.allocsPerKb = double(allocs.totalAllocations()) * 1024.0 /
+                            double(bytes) / reps;
+        }
+        fprintf(stderr, "%-28s %12zu %12.6f %12.6f %10.2f MB/s",
+                r.name.c_str(), r.bytes, r.median, r.p99, r.mbPerSecond());
+        if (AllocStats::enabled) {
+            fprintf(stderr, " %10.1f allocs/KB%s", r.allocsPerKb,
+                    overBudget(r) ? "  OVER BUDGET" : "");
+        }
+        fprintf(stderr, "\n");
+        results.push_back(r);
+        return results.back();
+    }
+
+    bool overBudget(const BenchResult& r) const {
+        return allocBudget > 0 && r.allocsPerKb > allocBudget;
+    }
+
+    bool withinBudget() const {
+        for (const BenchResult& r : results) {
+            if (overBudget(r)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void writeJson(FILE* out) const {
+        fprintf(out, "{\n  \"optimized\": %s,\n  \"warmup\": %d,\n",
+#ifdef __OPTIMIZE__
+                "true",
+#else
+                "false",
+#endif
+                warmup);
+        fprintf(out, "  \"results\": [");
+        for (size_t i = 0; i < results.size(); i++) {
+            const BenchResult& r = results[i];
+            fprintf(out,
+                    "%s\n    {\"name\": \"%s\", \"bytes\": %zu, \"reps\": %d, "
+                    "\"min\": %.9f, \"median\": %.9f, \"p99\": %.9f, "
+                    "\"mean\": %.9f, \"mb_per_second\": %.3f",
+                    i ? "," : "", r.name.c_str(), r.bytes, r.reps, r.min,
+                    r.median, r.p99, r.mean, r.mbPerSecond());
+            if (AllocStats::enabled) {
+                fprintf(out, ", \"allocs_per_kb\": %.1f", r.allocsPerKb);
+            }
+            fprintf(out, "}");
+        }
+        fprintf(out, "\n  ]\n}\n");
+    }
+};
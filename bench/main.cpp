@@ -0,0 +1,214 @@
+#include "Complexity.h"
+#include "Generator.h"
+#include "Harness.h"
+#include "Parser.h"
+#include "PrettyPrinter.h"
+#include "Tokenizer.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace std;
+
+// Sizes like 64K, 16M or 1G.
+static size_t parseSize(const string& s) {
+    char* end;
+    double v = strtod(s.c_str(), &end);
+    switch (*end) {
+    case 'k':
+    case 'K':
+        v *= 1 << 10;
+        break;
+    case 'm':
+    case 'M':
+        v *= 1 << 20;
+        break;
+    case 'g':
+    case 'G':
+        v *= 1 << 30;
+        break;
+    }
+    return size_t(v);
+}
+
+static string sizeName(size_t bytes) {
+    if (bytes >= (1 << 30) && bytes % (1 << 30) == 0) {
+        return to_string(bytes >> 30) + "G";
+    }
+    if (bytes >= (1 << 20) && bytes % (1 << 20) == 0) {
+        return to_string(bytes >> 20) + "M";
+    }
+    if (bytes >= (1 << 10) && bytes % (1 << 10) == 0) {
+        return to_string(bytes >> 10) + "K";
+    }
+    return to_string(bytes);
+}
+
+static bool parses(Parser& parser, const string& source, const char* what) {
+    parser.tokenize(source);
+    ParseResult r = parser.parseTokens();
+    if (!r.ok()) {
+        fprintf(stderr, "generated %s input does not parse: %s\n", what,
+                r.diagnostics[0].message.c_str());
+        return false;
+    }
+    return true;
+}
+
+// One size of every benchmark. Tokenizing is measured alone; the parsing
+// benchmarks start from tokens and the printing one from a parsed tree.
+static bool benchSize(Harness& h, const GeneratorOptions& base, size_t size) {
+    string suffix = "/" + sizeName(size);
+    GeneratorOptions options = base;
+    options.targetBytes = size;
+    string source = Generator(options).generate();
+
+    // expression statements only, so the time goes to the Pratt parser
+    GeneratorOptions exprOptions = options;
+    exprOptions.mix = StatementMix();
+    exprOptions.mix.assign = 0;
+    exprOptions.mix.augAssign = 0;
+    exprOptions.mix.annAssign = 0;
+    exprOptions.mix.whileLoop = 0;
+    exprOptions.mix.import = 0;
+    exprOptions.mix.assert_ = 0;
+    exprOptions.exprLength = max(options.exprLength, 16);
+    string expressions = Generator(exprOptions).generate();
+
+    Tokenizer tokenizer;
+    h.run("tokenize" + suffix, source.size(),
+          [&] { return tokenizer.tokenize(source); });
+
+    Parser exprParser;
+    if (!parses(exprParser, expressions, "expression")) {
+        return false;
+    }
+    h.run("pratt" + suffix, expressions.size(),
+          [&] { return exprParser.parseTokens(); });
+
+    Parser parser;
+    if (!parses(parser, source, "statement")) {
+        return false;
+    }
+    h.run("statements" + suffix, source.size(),
+          [&] { return parser.parseTokens(); });
+
+    ParseResult tree = parser.parseTokens();
+    h.run("print" + suffix, source.size(), [&] {
+        PrettyPrinter printer;
+        tree.module->accept(printer);
+        return move(printer.ctx.s);
+    });
+    return true;
+}
+
+static void usage() {
+    fprintf(stderr,
+            "usage: pyser_bench [options]\n"
+            "  --min-size N      smallest input (default 1K)\n"
+            "  --max-size N      largest input, up to 1G (default 4M)\n"
+            "  --reps N          timed repetitions (default 10)\n"
+            "  --warmup N        untimed repetitions (default 2)\n"
+            "  --seed N          generator seed (default 1)\n"
+            "  --depth N         deepest while nesting (default 3)\n"
+            "  --expr-length N   operators per expression (default 4)\n"
+            "  --literals P      share of literal operands (default 0.3)\n"
+            "  --json FILE       write the results as JSON\n"
+            "  --alloc-budget N  exit 1 if a benchmark makes more than N\n"
+            "                    allocations per input KB (PYSER_ALLOC_STATS)\n"
+            "  --dump            print the generated input of --max-size\n"
+            "  --complexity      fit growth exponents instead, exits 1 if one\n"
+            "                    is above --max-exponent (default 1.25)\n"
+            "  --axis NAME       only file_length, expression_length,\n"
+            "                    nesting_depth, chained_comparisons,\n"
+            "                    boolean_chains, bracket_nesting,\n"
+            "                    tuple_nesting or paren_nesting\n");
+}
+
+int main(int argc, char* argv[]) {
+    Harness h;
+    GeneratorOptions options;
+    size_t minSize = 1 << 10;
+    size_t maxSize = 4 << 20;
+    string json;
+    bool dump = false;
+    bool complexity = false;
+    ComplexityCheck check;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--min-size" && hasValue) {
+            minSize = parseSize(argv[++i]);
+        } else if (arg == "--max-size" && hasValue) {
+            maxSize = parseSize(argv[++i]);
+        } else if (arg == "--reps" && hasValue) {
+            h.reps = atoi(argv[++i]);
+        } else if (arg == "--warmup" && hasValue) {
+            h.warmup = atoi(argv[++i]);
+        } else if (arg == "--seed" && hasValue) {
+            options.seed = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--depth" && hasValue) {
+            options.maxDepth = atoi(argv[++i]);
+        } else if (arg == "--expr-length" && hasValue) {
+            options.exprLength = atoi(argv[++i]);
+        } else if (arg == "--literals" && hasValue) {
+            options.literalDensity = atof(argv[++i]);
+        } else if (arg == "--alloc-budget" && hasValue) {
+            h.allocBudget = atof(argv[++i]);
+        } else if (arg == "--json" && hasValue) {
+            json = argv[++i];
+        } else if (arg == "--dump") {
+            dump = true;
+        } else if (arg == "--complexity") {
+            complexity = true;
+        } else if (arg == "--axis" && hasValue) {
+            check.only = argv[++i];
+        } else if (arg == "--max-exponent" && hasValue) {
+            check.maxExponent = atof(argv[++i]);
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (minSize < 1 || maxSize > (size_t(1) << 30) || minSize > maxSize ||
+        h.reps < 1) {
+        usage();
+        return 2;
+    }
+
+    if (dump) {
+        options.targetBytes = maxSize;
+        fputs(Generator(options).generate().c_str(), stdout);
+        return 0;
+    }
+
+    FILE* out = stdout;
+    if (json.size() && !(out = fopen(json.c_str(), "w"))) {
+        fprintf(stderr, "cannot open %s\n", json.c_str());
+        return 2;
+    }
+
+    fprintf(stderr, "%-28s %12s %12s %12s %15s\n", "benchmark", "bytes",
+            "median s", "p99 s", "throughput");
+    int status = 0;
+    if (complexity) {
+        check.options = options;
+        status = check.run(h) ? 0 : 1;
+        check.writeJson(out);
+    } else {
+        for (size_t size = minSize; size <= maxSize; size *= 4) {
+            if (!benchSize(h, options, size)) {
+                return 1;
+            }
+        }
+        h.writeJson(out);
+        if (!h.withinBudget()) {
+            status = 1;
+        }
+    }
+    if (out != stdout) {
+        fclose(out);
+    }
+    return status;
+}
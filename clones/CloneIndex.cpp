@@ -0,0 +1,228 @@
+#include "CloneIndex.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// records per partition a writer gathers before appending them
+static constexpr size_t BUFFERED = 512;
+
+CloneIndex::Writer::Writer(CloneIndex& index)
+    : index(index), buffers(index.partitions()) {}
+
+void CloneIndex::Writer::add(const Fingerprint& f) {
+    unsigned p = index.partition(f.hash);
+    buffers[p].push_back(f);
+    if (buffers[p].size() >= BUFFERED) {
+        index.append(p, buffers[p]);
+        buffers[p].clear();
+    }
+}
+
+void CloneIndex::Writer::flush() {
+    for (unsigned p = 0; p < buffers.size(); p++) {
+        if (buffers[p].size()) {
+            index.append(p, buffers[p]);
+            buffers[p].clear();
+        }
+    }
+}
+
+CloneIndex::CloneIndex(const string& dir, unsigned partitions): dir(dir) {
+    while ((1u << bits) < partitions) {
+        bits++;
+    }
+    for (unsigned p = 0; p < (1u << bits); p++) {
+        files.push_back(std::make_unique<Partition>());
+        string name = path("partition", p);
+        if (!(files.back()->file = fopen(name.c_str(), "w+b"))) {
+            fail("cannot create " + name);
+            return;
+        }
+    }
+}
+
+CloneIndex::~CloneIndex() {
+    if (repeatedHashes) {
+        munmap((void*)repeatedHashes, repeatedCount * sizeof(uint64_t));
+    }
+    for (unsigned p = 0; p < files.size(); p++) {
+        if (files[p]->file) {
+            fclose(files[p]->file);
+            remove(path("partition", p).c_str());
+        }
+        remove(path("repeated", p).c_str());
+        remove(path("runs", p).c_str());
+    }
+    remove((dir + "/repeated").c_str());
+}
+
+bool CloneIndex::fail(const string& what) {
+    std::lock_guard<std::mutex> lock(errorMutex);
+    if (error.empty()) {
+        error = what + ": " + strerror(errno);
+    }
+    return false;
+}
+
+void CloneIndex::append(unsigned p, const vector<Fingerprint>& records) {
+    Partition& partition = *files[p];
+    std::lock_guard<std::mutex> lock(partition.mutex);
+    if (fwrite(records.data(), sizeof(Fingerprint), records.size(),
+               partition.file) != records.size()) {
+        fail("cannot write " + path("partition", p));
+    }
+}
+
+vector<Fingerprint> CloneIndex::load(unsigned p) {
+    FILE* file = files[p]->file;
+    vector<Fingerprint> records;
+    if (fflush(file) != 0 || fseek(file, 0, SEEK_END) != 0) {
+        fail("cannot read " + path("partition", p));
+        return records;
+    }
+    records.resize(size_t(ftell(file)) / sizeof(Fingerprint));
+    rewind(file);
+    if (fread(records.data(), sizeof(Fingerprint), records.size(), file) !=
+        records.size()) {
+        fail("cannot read " + path("partition", p));
+        records.clear();
+    }
+    return records;
+}
+
+bool CloneIndex::sortPartition(unsigned p) {
+    vector<Fingerprint> records = load(p);
+    if (!ok()) {
+        return false;
+    }
+    std::sort(records.begin(), records.end(),
+              [](const Fingerprint& a, const Fingerprint& b) {
+                  if (a.hash != b.hash) {
+                      return a.hash < b.hash;
+                  }
+                  if (a.file != b.file) {
+                      return a.file < b.file;
+                  }
+                  if (a.firstLine != b.firstLine) {
+                      return a.firstLine < b.firstLine;
+                  }
+                  return a.lastLine < b.lastLine;
+              });
+    FILE* file = files[p]->file;
+    rewind(file);
+    if (fwrite(records.data(), sizeof(Fingerprint), records.size(), file) !=
+        records.size()) {
+        return fail("cannot write " + path("partition", p));
+    }
+
+    vector<uint64_t> repeated;
+    vector<Fingerprint> runs;
+    for (size_t i = 0, j; i < records.size(); i = j) {
+        for (j = i + 1; j < records.size() && records[j].hash == records[i].hash;
+             j++) {
+        }
+        if (j - i < 2) {
+            continue;
+        }
+        repeated.push_back(records[i].hash);
+        if (records[i].run) {
+            runs.insert(runs.end(), records.begin() + i, records.begin() + j);
+        }
+    }
+    return writeFile(path("repeated", p), repeated.data(),
+                     repeated.size() * sizeof(uint64_t)) &&
+           writeFile(path("runs", p), runs.data(),
+                     runs.size() * sizeof(Fingerprint));
+}
+
+bool CloneIndex::writeFile(const string& name, const void* data,
+                           size_t bytes) {
+    FILE* out = fopen(name.c_str(), "wb");
+    if (!out) {
+        return fail("cannot create " + name);
+    }
+    size_t written = fwrite(data, 1, bytes, out);
+    if (fclose(out) != 0 || written != bytes) {
+        return fail("cannot write " + name);
+    }
+    return true;
+}
+
+vector<Fingerprint> CloneIndex::repeatedRuns(unsigned p) {
+    string name = path("runs", p);
+    vector<Fingerprint> runs;
+    FILE* in = fopen(name.c_str(), "rb");
+    if (!in) {
+        fail("cannot read " + name);
+        return runs;
+    }
+    if (fseek(in, 0, SEEK_END) == 0) {
+        runs.resize(size_t(ftell(in)) / sizeof(Fingerprint));
+        rewind(in);
+    }
+    if (fread(runs.data(), sizeof(Fingerprint), runs.size(), in) !=
+        runs.size()) {
+        fail("cannot read " + name);
+        runs.clear();
+    }
+    fclose(in);
+    return runs;
+}
+
+// The partitions split the hashes by their top bits, so their sorted lists
+// joined in order are sorted as a whole.
+bool CloneIndex::mapRepeated() {
+    string name = dir + "/repeated";
+    FILE* out = fopen(name.c_str(), "wb");
+    if (!out) {
+        return fail("cannot create " + name);
+    }
+    char buf[1 << 16];
+    for (unsigned p = 0; p < files.size(); p++) {
+        FILE* in = fopen(path("repeated", p).c_str(), "rb");
+        if (!in) {
+            fclose(out);
+            return fail("cannot read " + path("repeated", p));
+        }
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+            fwrite(buf, 1, n, out);
+        }
+        fclose(in);
+        remove(path("repeated", p).c_str());
+    }
+    if (fclose(out) != 0) {
+        return fail("cannot write " + name);
+    }
+
+    int fd = open(name.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return fail("cannot read " + name);
+    }
+    repeatedCount = size_t(st.st_size) / sizeof(uint64_t);
+    if (repeatedCount) {
+        void* map = mmap(nullptr, repeatedCount * sizeof(uint64_t), PROT_READ,
+                         MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            close(fd);
+            repeatedCount = 0;
+            return fail("cannot map " + name);
+        }
+        repeatedHashes = (const uint64_t*)map;
+    }
+    close(fd);
+    return true;
+}
+
+bool CloneIndex::repeated(uint64_t hash) const {
+    return std::binary_search(repeatedHashes, repeatedHashes + repeatedCount,
+                              hash);
+}
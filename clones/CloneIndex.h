@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Fingerprint.h"
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+// Fingerprints of a corpus bucketed on disk by the top bits of their hash,
+// so the corpus is indexed in bounded memory: writers fill buffers of their
+// own and append them to partition files, and each partition is later
+// loaded, sorted and written back alone. The hashes occurring more than
+// once, concatenated over the sorted partitions, end up sorted too and are
+// looked up through a memory map.
+class CloneIndex {
+public:
+    // Buffers fingerprints for one thread.
+    class Writer {
+    public:
+        explicit Writer(CloneIndex& index);
+        ~Writer() { flush(); }
+        void add(const Fingerprint& f);
+        void flush();
+
+    private:
+        CloneIndex& index;
+        vector<vector<Fingerprint>> buffers;
+    };
+
+    // `dir` must exist; partitions is a power of two. The files go with
+    // the index.
+    CloneIndex(const string& dir, unsigned partitions);
+    ~CloneIndex();
+
+    unsigned partitions() const { return unsigned(files.size()); }
+    // the top bits of the hash
+    unsigned partition(uint64_t hash) const {
+        return bits ? unsigned(hash >> (64 - bits)) : 0;
+    }
+
+    bool ok() const { return error.empty(); }
+
+    // Sorts partition p on disk by hash, file and line, and sets aside the
+    // hashes occurring more than once in it and the copies of the runs
+    // among them. Once every writer is done.
+    bool sortPartition(unsigned p);
+    // Joins the hashes set aside by every partition and maps them.
+    bool mapRepeated();
+    // Whether a hash occurs more than once in the corpus, once mapped.
+    bool repeated(uint64_t hash) const;
+
+    // Partition p as sorted by sortPartition().
+    vector<Fingerprint> load(unsigned p);
+    // The copies of the runs occurring more than once in partition p, in
+    // the same order.
+    vector<Fingerprint> repeatedRuns(unsigned p);
+
+public:
+    string error;
+
+private:
+    string path(const string& name, unsigned p) const {
+        return dir + "/" + name + "-" + std::to_string(p);
+    }
+    void append(unsigned p, const vector<Fingerprint>& records);
+    bool writeFile(const string& name, const void* data, size_t bytes);
+    bool fail(const string& what);
+
+private:
+    class Partition {
+    public:
+        std::mutex mutex;
+        FILE* file = nullptr;
+    };
+
+    string dir;
+    int bits = 0;
+    vector<unique_ptr<Partition>> files;
+    std::mutex errorMutex;
+    const uint64_t* repeatedHashes = nullptr;
+    size_t repeatedCount = 0;
+};
@@ -0,0 +1,120 @@
+#include "Fingerprint.h"
+#include "RecursiveVisitor.h"
+#include "SourceFiles.h"
+#include <algorithm>
+#include <functional>
+#include <string_view>
+#include <unordered_map>
+
+using std::unordered_map;
+
+namespace {
+
+bool isStatement(NodeKind kind) {
+    return kind >= NodeKind::FunctionDef && kind <= NodeKind::Continue;
+}
+
+// statements and expressions, what follows the module in NodeKind order
+bool isUnit(NodeKind kind) { return kind > NodeKind::Module; }
+
+// The statement lists of a node.
+template <class F> void eachBlock(ast& node, F&& f) {
+    switch (node.kind) {
+    case NodeKind::Module:
+        f(static_cast<Module&>(node).body);
+        break;
+    case NodeKind::FunctionDef:
+        f(static_cast<FunctionDef&>(node).body);
+        break;
+    case NodeKind::ClassDef:
+        f(static_cast<ClassDef&>(node).body);
+        break;
+    case NodeKind::For:
+        f(static_cast<For&>(node).body);
+        f(static_cast<For&>(node).orelse);
+        break;
+    case NodeKind::While:
+        f(static_cast<While&>(node).body);
+        f(static_cast<While&>(node).orelse);
+        break;
+    case NodeKind::If:
+        f(static_cast<If&>(node).body);
+        f(static_cast<If&>(node).orelse);
+        break;
+    default:
+        break;
+    }
+}
+
+} // namespace
+
+void fingerprint(ast& root, const string& source, uint32_t file,
+                 const FingerprintOptions& options, vector<Fingerprint>& out) {
+    SourceLines lines(source);
+    auto lastLine = [&](uint32_t begin, uint32_t end) {
+        return lines.line(end > begin ? end - 1 : begin);
+    };
+
+    // preorder with parents, with an explicit stack as operator chains can
+    // be deeper than the native one; sizes are then summed up backwards
+    class Item {
+    public:
+        ast* node;
+        uint32_t parent;
+        uint32_t nodes;
+    };
+    vector<Item> items;
+    vector<std::pair<ast*, uint32_t>> stack{{&root, UINT32_MAX}};
+    while (!stack.empty()) {
+        auto [node, parent] = stack.back();
+        stack.pop_back();
+        uint32_t id = uint32_t(items.size());
+        items.push_back({node, parent, 1});
+        forEachChild(*node,
+                     [&](auto& child) { stack.push_back({child.get(), id}); });
+    }
+    for (size_t i = items.size(); i-- > 1;) {
+        items[items[i].parent].nodes += items[i].nodes;
+    }
+
+    unordered_map<const ast*, uint32_t> statementNodes;
+    for (const Item& item : items) {
+        const ast& node = *item.node;
+        if (isStatement(node.kind)) {
+            statementNodes[&node] = item.nodes;
+        }
+        if (!isUnit(node.kind) || item.nodes < options.minNodes) {
+            continue;
+        }
+        uint64_t parent =
+            item.parent == UINT32_MAX ? 0 : items[item.parent].node->hash;
+        out.push_back({node.hash, parent, file, lines.line(node.span.begin),
+                       lastLine(node.span.begin, node.span.end), item.nodes,
+                       0});
+    }
+
+    // runs of statements, hashed from the hashes of the statements
+    string key;
+    for (const Item& item : items) {
+        eachBlock(*item.node, [&](stmtPs& block) {
+            uint64_t previous = item.node->hash;
+            for (size_t i = 0; i + options.run <= block.size(); i++) {
+                key.assign("run");
+                uint32_t nodes = 0;
+                for (size_t j = i; j < i + options.run; j++) {
+                    key.append((const char*)&block[j]->hash,
+                               sizeof(block[j]->hash));
+                    nodes += statementNodes[block[j].get()];
+                }
+                uint64_t hash = std::hash<std::string_view>()(key);
+                if (nodes >= options.minNodes) {
+                    uint32_t begin = block[i]->span.begin;
+                    uint32_t end = block[i + options.run - 1]->span.end;
+                    out.push_back({hash, previous, file, lines.line(begin),
+                                   lastLine(begin, end), nodes, 1});
+                }
+                previous = hash;
+            }
+        });
+    }
+}
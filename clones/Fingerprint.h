@@ -0,0 +1,42 @@
+#pragma once
+
+#include "AST.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+// A piece of code worth comparing: an expression or a statement, or a run
+// of consecutive statements of a block. Written to disk as is.
+class Fingerprint {
+public:
+    // normalized structural hash, identifiers left out
+    uint64_t hash;
+    // the fingerprint this one is part of: the parent node, or for a run
+    // the run starting one statement earlier, else the owner of the block
+    uint64_t parent;
+    uint32_t file;
+    uint32_t firstLine;
+    uint32_t lastLine;
+    // nodes covered
+    uint32_t nodes : 31;
+    // a run of statements rather than a node
+    uint32_t run : 1;
+};
+
+static_assert(sizeof(Fingerprint) == 32, "fingerprints are stored packed");
+
+class FingerprintOptions {
+public:
+    // smaller pieces are too common to be worth reporting
+    uint32_t minNodes = 24;
+    // statements in a run
+    uint32_t run = 3;
+};
+
+// Fingerprints of a tree parsed with Parser::hashIdentifiers off, from
+// `source`, its text.
+void fingerprint(ast& root, const string& source, uint32_t file,
+                 const FingerprintOptions& options, vector<Fingerprint>& out);
@@ -0,0 +1,286 @@
+#include "CloneIndex.h"
+#include "Fingerprint.h"
+#include "Parser.h"
+#include "SourceFiles.h"
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+static void usage() {
+    fprintf(stderr,
+            "usage: pyser_clones [options] PATH...\n"
+            "Reports code duplicated across the .py files given or found "
+            "under the\n"
+            "directories given, regardless of naming.\n"
+            "  --files-from FILE  more paths, one per line\n"
+            "  --min-nodes N      smallest piece reported, in nodes (24)\n"
+            "  --run N            statements compared in a row (3)\n"
+            "  --jobs, -j N       threads, 0 for one per core (1)\n"
+            "  --timeout-ms N     time allowed to parse a file, none by "
+            "default\n"
+            "  --max-steps N      parser steps allowed per file\n"
+            "  --max-depth N      nesting allowed in a file (3000)\n"
+            "  --partitions N     on-disk buckets, more for less memory (256)\n"
+            "  --work-dir DIR     where the index goes (a temporary "
+            "directory)\n");
+}
+
+// Lines of the runs reported, per file: sorted, overlapping ones merged.
+typedef vector<vector<pair<uint32_t, uint32_t>>> RunLines;
+
+static bool inRun(const vector<pair<uint32_t, uint32_t>>& runs,
+                  const Fingerprint& f) {
+    auto it = upper_bound(runs.begin(), runs.end(),
+                          pair<uint32_t, uint32_t>(f.firstLine, UINT32_MAX));
+    return it != runs.begin() && prev(it)->second >= f.lastLine;
+}
+
+// Whether the copies of a clone, [begin, end), are all part of a bigger
+// piece reported anyway: their parents are one piece occurring more than
+// once too, or they all lie in runs reported, if `runs` are known.
+static bool covered(const CloneIndex& index, const Fingerprint* begin,
+                    const Fingerprint* end, const RunLines* runs) {
+    uint64_t parent = begin->parent;
+    if (all_of(begin, end,
+               [&](const Fingerprint& f) { return f.parent == parent; }) &&
+        index.repeated(parent)) {
+        return true;
+    }
+    return runs && !begin->run &&
+           all_of(begin, end, [&](const Fingerprint& f) {
+               return inRun((*runs)[f.file], f);
+           });
+}
+
+// Runs reported, which the statements in them are not: the runs covered by
+// a bigger piece are left out of the report as a whole, not statement by
+// statement.
+static RunLines reportedRuns(CloneIndex& index, WorkStealingPool& pool,
+                             size_t files) {
+    RunLines runs(files);
+    std::mutex runsMutex;
+    pool.run(index.partitions(), [&](size_t p) {
+        vector<Fingerprint> records = index.repeatedRuns(unsigned(p));
+        for (size_t i = 0, j; i < records.size(); i = j) {
+            for (j = i + 1;
+                 j < records.size() && records[j].hash == records[i].hash;
+                 j++) {
+            }
+            if (covered(index, &records[i], &records[j], nullptr)) {
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(runsMutex);
+            for (size_t k = i; k < j; k++) {
+                runs[records[k].file].push_back(
+                    {records[k].firstLine, records[k].lastLine});
+            }
+        }
+    });
+    for (vector<pair<uint32_t, uint32_t>>& lines : runs) {
+        sort(lines.begin(), lines.end());
+        size_t merged = 0;
+        for (const pair<uint32_t, uint32_t>& l : lines) {
+            if (merged && l.first <= lines[merged - 1].second) {
+                lines[merged - 1].second =
+                    max(lines[merged - 1].second, l.second);
+            } else {
+                lines[merged++] = l;
+            }
+        }
+        lines.resize(merged);
+    }
+    return runs;
+}
+
+// Clones of one partition, but for those covered by a bigger piece.
+static string report(CloneIndex& index, unsigned p, const RunLines& runs,
+                     const vector<string>& paths, size_t& classes) {
+    string out;
+    vector<Fingerprint> records = index.load(p);
+    for (size_t i = 0, j; i < records.size(); i = j) {
+        for (j = i + 1;
+             j < records.size() && records[j].hash == records[i].hash; j++) {
+        }
+        if (j - i < 2 || covered(index, &records[i], &records[j], &runs)) {
+            continue;
+        }
+        classes++;
+        char buf[96];
+        snprintf(buf, sizeof(buf), "clone of %u nodes, %zu copies\n",
+                 uint32_t(records[i].nodes), j - i);
+        out += buf;
+        for (size_t k = i; k < j; k++) {
+            const Fingerprint* f = &records[k];
+            if (f->firstLine == f->lastLine) {
+                snprintf(buf, sizeof(buf), ":%u\n", f->firstLine);
+            } else {
+                snprintf(buf, sizeof(buf), ":%u-%u\n", f->firstLine,
+                         f->lastLine);
+            }
+            out += "  " + paths[f->file] + buf;
+        }
+    }
+    return out;
+}
+
+int main(int argc, char* argv[]) {
+    FingerprintOptions options;
+    ParseLimits limits;
+    limits.maxDepth = ParseLimits::safeDepth;
+    long timeoutMs = 0;
+    unsigned jobs = 1;
+    unsigned partitions = 256;
+    string workDir;
+    vector<string> paths;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--files-from" && i + 1 < argc) {
+            if (!addPathsFrom(argv[++i], paths)) {
+                fprintf(stderr, "cannot open %s\n", argv[i]);
+                return 2;
+            }
+        } else if (arg == "--min-nodes" && i + 1 < argc) {
+            options.minNodes = uint32_t(max(1, atoi(argv[++i])));
+        } else if (arg == "--run" && i + 1 < argc) {
+            options.run = uint32_t(max(2, atoi(argv[++i])));
+        } else if ((arg == "--jobs" || arg == "-j") && i + 1 < argc) {
+            int n = atoi(argv[++i]);
+            jobs = n > 0 ? unsigned(n) : std::thread::hardware_concurrency();
+        } else if (arg == "--timeout-ms" && i + 1 < argc) {
+            timeoutMs = atol(argv[++i]);
+        } else if (arg == "--max-steps" && i + 1 < argc) {
+            limits.maxSteps = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--max-depth" && i + 1 < argc) {
+            limits.maxDepth = atoi(argv[++i]);
+        } else if (arg == "--partitions" && i + 1 < argc) {
+            // every partition keeps a file open
+            partitions = unsigned(min(max(1, atoi(argv[++i])), 512));
+        } else if (arg == "--work-dir" && i + 1 < argc) {
+            workDir = argv[++i];
+        } else if (arg == "--help" || arg == "-h") {
+            usage();
+            return 0;
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            fprintf(stderr, "unknown option: %s\n", argv[i]);
+            usage();
+            return 2;
+        } else {
+            addPath(arg, paths);
+        }
+    }
+    if (paths.empty()) {
+        usage();
+        return 2;
+    }
+    jobs = max(1u, jobs);
+
+    bool ownDir = workDir.empty();
+    if (ownDir) {
+        const char* tmp = getenv("TMPDIR");
+        string pattern = string(tmp ? tmp : "/tmp") + "/pyser-clones-XXXXXX";
+        if (!mkdtemp(pattern.data())) {
+            fprintf(stderr, "cannot create a directory in %s\n",
+                    tmp ? tmp : "/tmp");
+            return 2;
+        }
+        workDir = pattern;
+    }
+
+    int status = 0;
+    {
+        CloneIndex index(workDir, partitions);
+        atomic<size_t> unreadable{0};
+        atomic<size_t> broken{0};
+        atomic<size_t> fingerprints{0};
+        WorkStealingPool pool(jobs);
+        if (index.ok()) {
+            // one file per thread at a time, the fingerprints going straight
+            // to the partitions
+            vector<optional<Parser>> parsers(jobs);
+            vector<unique_ptr<CloneIndex::Writer>> writers(jobs);
+            pool.run(paths.size(), [&](size_t i) {
+                string source;
+                if (!readFile(paths[i], source)) {
+                    fprintf(stderr, "cannot open %s\n", paths[i].c_str());
+                    unreadable++;
+                    return;
+                }
+                unsigned w = WorkStealingPool::worker();
+                if (!parsers[w]) {
+                    parsers[w].emplace();
+                    parsers[w]->hashIdentifiers = false;
+                    writers[w] = make_unique<CloneIndex::Writer>(index);
+                }
+                // a file over a limit is broken, what was parsed of it still
+                // fingerprinted
+                ParseLimits fileLimits = limits;
+                if (timeoutMs > 0) {
+                    fileLimits.deadline =
+                        std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(timeoutMs);
+                }
+                ParseResult result = parsers[w]->parse(source, fileLimits);
+                if (!result.ok()) {
+                    broken++;
+                }
+                vector<Fingerprint> found;
+                fingerprint(*result.module, source, uint32_t(i), options,
+                            found);
+                fingerprints += found.size();
+                for (const Fingerprint& f : found) {
+                    writers[w]->add(f);
+                }
+            });
+            writers.clear();
+        }
+        if (index.ok()) {
+            pool.run(index.partitions(),
+                     [&](size_t p) { index.sortPartition(unsigned(p)); });
+        }
+        if (index.ok() && index.mapRepeated()) {
+            RunLines runs = reportedRuns(index, pool, paths.size());
+            // partitions finish in any order but are printed in order
+            std::mutex printMutex;
+            vector<optional<string>> done(index.partitions());
+            size_t printed = 0;
+            atomic<size_t> classes{0};
+            pool.runInOrder(index.partitions(), [&](size_t p) {
+                size_t found = 0;
+                string out = report(index, unsigned(p), runs, paths, found);
+                classes += found;
+                std::lock_guard<std::mutex> lock(printMutex);
+                done[p] = move(out);
+                for (; printed < done.size() && done[printed]; printed++) {
+                    fputs(done[printed]->c_str(), stdout);
+                    done[printed].reset();
+                }
+            });
+            fflush(stdout);
+            fprintf(stderr, "%zu files, %zu with errors, %zu fingerprints, "
+                            "%zu clones\n",
+                    paths.size() - unreadable, size_t(broken),
+                    size_t(fingerprints), size_t(classes));
+        }
+        if (!index.ok()) {
+            fprintf(stderr, "%s\n", index.error.c_str());
+            status = 2;
+        } else if (unreadable) {
+            status = 1;
+        }
+    }
+    if (ownDir) {
+        rmdir(workDir.c_str());
+    }
+    return status;
+}
@@ -0,0 +1,430 @@
+#include "SearchIndex.h"
+#include "PassManager.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// An index file is a header, a table of the paths of the files, a table of
+// the terms sorted by name, the strings the tables point into, and the
+// postings of every term. The postings of a term are varints, sorted by
+// file and offset: the distance to the file of the previous posting, then
+// the offset, or its distance to the previous one in the same file.
+// Offsets in the file are absolute and the tables 8-byte aligned.
+namespace {
+
+constexpr char MAGIC[8] = {'P', 'Y', 'S', 'E', 'R', 'I', 'D', 'X'};
+constexpr uint32_t VERSION = 1;
+
+class Header {
+public:
+    char magic[8];
+    uint32_t version;
+    uint32_t files;
+    uint64_t terms;
+    uint64_t pathTable;
+    uint64_t termTable;
+    // of the whole file
+    uint64_t size;
+};
+
+class PathEntry {
+public:
+    uint64_t offset;
+    uint64_t length;
+};
+
+class TermEntry {
+public:
+    uint64_t name;
+    uint32_t nameLength;
+    uint32_t count;
+    uint64_t postings;
+    uint64_t bytes;
+};
+
+// longer chains are not indexed as uses or calls
+constexpr size_t MAX_QUALIFIED = 16;
+
+void putVarint(string& out, uint32_t v) {
+    while (v >= 0x80) {
+        out += char(v | 0x80);
+        v >>= 7;
+    }
+    out += char(v);
+}
+
+bool getVarint(const char*& p, const char* end, uint32_t& v) {
+    v = 0;
+    for (int shift = 0; p < end && shift < 35; shift += 7) {
+        uint8_t byte = uint8_t(*p++);
+        v |= uint32_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Dotted name of a Name or of an Attribute chain on one.
+bool qualifiedName(const expr* e, string& out) {
+    const string* parts[MAX_QUALIFIED];
+    size_t count = 0;
+    while (e && e->kind == NodeKind::Attribute) {
+        if (count == MAX_QUALIFIED) {
+            return false;
+        }
+        const Attribute& a = static_cast<const Attribute&>(*e);
+        parts[count++] = &a.attr;
+        e = a.value.get();
+    }
+    if (!e || e->kind != NodeKind::Name) {
+        return false;
+    }
+    out = static_cast<const Name&>(*e).id;
+    while (count > 0) {
+        out += '.';
+        out += *parts[--count];
+    }
+    return true;
+}
+
+// The terms of indexTerms, one pass per family, all run in a single walk.
+class TermPass: public AstPass {
+public:
+    explicit TermPass(vector<TermAt>& terms): terms(terms) {}
+
+protected:
+    vector<TermAt>& terms;
+    string name;
+};
+
+class KindTerms: public TermPass {
+public:
+    using TermPass::TermPass;
+    void enter(ast& node) override {
+        terms.emplace_back(string("kind:") + nodeKindName(node.kind),
+                           node.span.begin);
+    }
+};
+
+class NameTerms: public TermPass {
+public:
+    using TermPass::TermPass;
+    void enter(ast& node) override {
+        terms.emplace_back("name:" + static_cast<Name&>(node).id,
+                           node.span.begin);
+    }
+};
+
+class AttributeTerms: public TermPass {
+public:
+    using TermPass::TermPass;
+    void enter(ast& node) override {
+        uint32_t at = node.span.begin;
+        terms.emplace_back("attr:" + static_cast<Attribute&>(node).attr, at);
+        if (qualifiedName(static_cast<expr*>(&node), name)) {
+            terms.emplace_back("use:" + name, at);
+        }
+    }
+};
+
+class CallTerms: public TermPass {
+public:
+    using TermPass::TermPass;
+    void enter(ast& node) override {
+        if (qualifiedName(static_cast<Call&>(node).func.get(), name)) {
+            terms.emplace_back("call:" + name, node.span.begin);
+        }
+    }
+};
+
+class ImportTerms: public TermPass {
+public:
+    using TermPass::TermPass;
+    void enter(ast& node) override {
+        uint32_t at = node.span.begin;
+        if (node.kind == NodeKind::Import) {
+            for (const alias& a : static_cast<Import&>(node).names) {
+                terms.emplace_back("import:" + a.name, at);
+            }
+            return;
+        }
+        ImportFrom& i = static_cast<ImportFrom&>(node);
+        terms.emplace_back("import:" + string(size_t(i.level), '.') +
+                               i.module.value_or(""),
+                           at);
+    }
+};
+
+} // namespace
+
+void indexTerms(ast& root, vector<TermAt>& terms) {
+    KindTerms kinds(terms);
+    NameTerms names(terms);
+    AttributeTerms attributes(terms);
+    CallTerms calls(terms);
+    ImportTerms imports(terms);
+    PassManager passes;
+    passes.add(kinds);
+    passes.add(names, {NodeKind::Name});
+    passes.add(attributes, {NodeKind::Attribute});
+    passes.add(calls, {NodeKind::Call});
+    passes.add(imports, {NodeKind::Import, NodeKind::ImportFrom});
+    passes.run(root);
+}
+
+void SearchIndexBuilder::addFile(const string& path, vector<TermAt>& found) {
+    uint32_t file = uint32_t(paths.size());
+    paths.push_back(path);
+    std::sort(found.begin(), found.end());
+    found.erase(std::unique(found.begin(), found.end()), found.end());
+    Postings* p = nullptr;
+    for (size_t i = 0; i < found.size(); i++) {
+        if (i == 0 || found[i].first != found[i - 1].first) {
+            p = &terms[found[i].first];
+        }
+        uint32_t offset = found[i].second;
+        if (p->count == 0 || file != p->lastFile) {
+            putVarint(p->bytes, file - p->lastFile);
+            putVarint(p->bytes, offset);
+        } else {
+            putVarint(p->bytes, 0);
+            putVarint(p->bytes, offset - p->lastOffset);
+        }
+        p->count++;
+        p->lastFile = file;
+        p->lastOffset = offset;
+    }
+}
+
+static uint64_t aligned(uint64_t n) { return (n + 7) & ~uint64_t(7); }
+
+bool SearchIndexBuilder::write(const string& path, string& error) {
+    vector<const std::pair<const string, Postings>*> sorted;
+    sorted.reserve(terms.size());
+    for (const auto& t : terms) {
+        sorted.push_back(&t);
+    }
+    std::sort(sorted.begin(), sorted.end(),
+              [](auto* a, auto* b) { return a->first < b->first; });
+
+    Header header{};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.files = uint32_t(paths.size());
+    header.terms = sorted.size();
+    header.pathTable = sizeof(Header);
+    header.termTable = header.pathTable + paths.size() * sizeof(PathEntry);
+    uint64_t strings = header.termTable + sorted.size() * sizeof(TermEntry);
+
+    vector<PathEntry> pathTable;
+    uint64_t at = strings;
+    for (const string& p : paths) {
+        pathTable.push_back({at, p.size()});
+        at += p.size();
+    }
+    vector<TermEntry> termTable;
+    for (auto* t : sorted) {
+        termTable.push_back({at, uint32_t(t->first.size()), t->second.count,
+                             0, t->second.bytes.size()});
+        at += t->first.size();
+    }
+    uint64_t stringsEnd = at;
+    uint64_t postings = aligned(at);
+    at = postings;
+    for (TermEntry& e : termTable) {
+        e.postings = at;
+        at += e.bytes;
+    }
+    header.size = at;
+
+    string temp = path + ".tmp";
+    FILE* out = fopen(temp.c_str(), "wb");
+    if (!out) {
+        error = "cannot create " + temp + ": " + strerror(errno);
+        return false;
+    }
+    fwrite(&header, sizeof(header), 1, out);
+    fwrite(pathTable.data(), sizeof(PathEntry), pathTable.size(), out);
+    fwrite(termTable.data(), sizeof(TermEntry), termTable.size(), out);
+    for (const string& p : paths) {
+        fwrite(p.data(), 1, p.size(), out);
+    }
+    for (auto* t : sorted) {
+        fwrite(t->first.data(), 1, t->first.size(), out);
+    }
+    static const char padding[8] = {};
+    fwrite(padding, 1, postings - stringsEnd, out);
+    for (auto* t : sorted) {
+        fwrite(t->second.bytes.data(), 1, t->second.bytes.size(), out);
+    }
+    bool written = !ferror(out);
+    if (fclose(out) != 0 || !written) {
+        error = "cannot write " + temp + ": " + strerror(errno);
+        remove(temp.c_str());
+        return false;
+    }
+    if (rename(temp.c_str(), path.c_str()) != 0) {
+        error = "cannot rename " + temp + ": " + strerror(errno);
+        remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+SearchIndex::~SearchIndex() {
+    if (data) {
+        munmap((void*)data, size);
+    }
+}
+
+bool SearchIndex::open(const string& path, string& error) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        error = "cannot open " + path + ": " + strerror(errno);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return false;
+    }
+    size = size_t(st.st_size);
+    void* map = size >= sizeof(Header)
+                    ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0)
+                    : MAP_FAILED;
+    close(fd);
+    if (map == MAP_FAILED) {
+        error = path + " is not an index";
+        size = 0;
+        return false;
+    }
+    data = (const char*)map;
+
+    const Header& h = *(const Header*)data;
+    uint64_t tables = h.termTable + h.terms * sizeof(TermEntry);
+    if (memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.version != VERSION ||
+        h.size != size || h.pathTable != sizeof(Header) ||
+        h.termTable != h.pathTable + uint64_t(h.files) * sizeof(PathEntry) ||
+        h.terms > size || tables > size) {
+        error = path + " is not an index, or of another version";
+        return false;
+    }
+    return true;
+}
+
+uint32_t SearchIndex::files() const { return ((const Header*)data)->files; }
+
+size_t SearchIndex::terms() const { return ((const Header*)data)->terms; }
+
+string_view SearchIndex::path(uint32_t file) const {
+    const Header& h = *(const Header*)data;
+    if (file >= h.files) {
+        return {};
+    }
+    const PathEntry& e = ((const PathEntry*)(data + h.pathTable))[file];
+    if (e.offset > size || e.length > size - e.offset) {
+        return {};
+    }
+    return {data + e.offset, size_t(e.length)};
+}
+
+string_view SearchIndex::termName(size_t i) const {
+    const Header& h = *(const Header*)data;
+    const TermEntry& e = ((const TermEntry*)(data + h.termTable))[i];
+    if (e.name > size || e.nameLength > size - e.name) {
+        return {};
+    }
+    return {data + e.name, e.nameLength};
+}
+
+size_t SearchIndex::lowerBound(string_view term) const {
+    size_t lo = 0, hi = terms();
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (termName(mid) < term) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+vector<Posting> SearchIndex::postings(size_t i) const {
+    const Header& h = *(const Header*)data;
+    const TermEntry& e = ((const TermEntry*)(data + h.termTable))[i];
+    vector<Posting> found;
+    if (e.postings > size || e.bytes > size - e.postings) {
+        return found;
+    }
+    // a posting takes two bytes at least, whatever a corrupt count says
+    found.reserve(std::min<uint64_t>(e.count, e.bytes / 2));
+    const char* p = data + e.postings;
+    const char* end = p + e.bytes;
+    uint32_t file = 0, offset = 0;
+    for (uint32_t n = 0; n < e.count; n++) {
+        uint32_t fileDelta, offsetValue;
+        if (!getVarint(p, end, fileDelta) || !getVarint(p, end, offsetValue)) {
+            break;
+        }
+        file += fileDelta;
+        offset = fileDelta || n == 0 ? offsetValue : offset + offsetValue;
+        found.push_back({file, offset});
+    }
+    return found;
+}
+
+vector<Posting> SearchIndex::find(string_view term) const {
+    size_t i = lowerBound(term);
+    if (i == terms() || termName(i) != term) {
+        return {};
+    }
+    return postings(i);
+}
+
+vector<string_view> SearchIndex::termsWithPrefix(string_view prefix) const {
+    vector<string_view> found;
+    for (size_t i = lowerBound(prefix); i < terms(); i++) {
+        string_view name = termName(i);
+        if (name.substr(0, prefix.size()) != prefix) {
+            break;
+        }
+        found.push_back(name);
+    }
+    return found;
+}
+
+vector<uint32_t> SearchIndex::filesWith(string_view term) const {
+    vector<uint32_t> found;
+    for (const Posting& p : find(term)) {
+        if (found.empty() || found.back() != p.file) {
+            found.push_back(p.file);
+        }
+    }
+    return found;
+}
+
+vector<uint32_t> SearchIndex::filesImporting(string_view module) const {
+    string term = "import:" + string(module);
+    vector<uint32_t> found = filesWith(term);
+    for (string_view sub : termsWithPrefix(term + ".")) {
+        vector<uint32_t> more = filesWith(sub);
+        found.insert(found.end(), more.begin(), more.end());
+    }
+    std::sort(found.begin(), found.end());
+    found.erase(std::unique(found.begin(), found.end()), found.end());
+    return found;
+}
+
+vector<Posting> SearchIndex::intersect(const vector<Posting>& a,
+                                       const vector<Posting>& b) {
+    vector<Posting> both;
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(),
+                          std::back_inserter(both));
+    return both;
+}
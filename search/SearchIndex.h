@@ -0,0 +1,102 @@
+#pragma once
+
+#include "AST.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using std::string;
+using std::string_view;
+using std::unordered_map;
+using std::vector;
+
+// A place a term occurs at.
+class Posting {
+public:
+    bool operator==(const Posting& o) const {
+        return file == o.file && offset == o.offset;
+    }
+    bool operator<(const Posting& o) const {
+        return file != o.file ? file < o.file : offset < o.offset;
+    }
+
+public:
+    uint32_t file;
+    // byte offset in the file
+    uint32_t offset;
+};
+
+// A term of a tree and where it starts.
+typedef std::pair<string, uint32_t> TermAt;
+
+// Appends the terms of a tree, what the index records of it:
+//   name:ID       a Name
+//   attr:ATTR     an Attribute, whatever its object
+//   use:A.B.C     an Attribute chain on a Name, where the chain starts
+//   call:A.B      a Call of a Name or of such a chain
+//   import:M      a module imported, relative ones with their leading dots
+//   kind:KIND     any node, by its class
+void indexTerms(ast& root, vector<TermAt>& terms);
+
+// Gathers the postings of files added one after the other, already delta
+// encoded, so memory stays near the size of the index written.
+class SearchIndexBuilder {
+public:
+    // The next file and its terms, in any order.
+    void addFile(const string& path, vector<TermAt>& terms);
+    bool write(const string& path, string& error);
+
+private:
+    class Postings {
+    public:
+        string bytes;
+        uint32_t count = 0;
+        uint32_t lastFile = 0;
+        uint32_t lastOffset = 0;
+    };
+
+    vector<string> paths;
+    unordered_map<string, Postings> terms;
+};
+
+// An index file mapped read-only. A lookup is a binary search of the term
+// table and the decoding of the postings of the term, nothing is parsed.
+class SearchIndex {
+public:
+    SearchIndex() = default;
+    SearchIndex(const SearchIndex&) = delete;
+    SearchIndex& operator=(const SearchIndex&) = delete;
+    ~SearchIndex();
+
+    bool open(const string& path, string& error);
+
+    uint32_t files() const;
+    string_view path(uint32_t file) const;
+    size_t terms() const;
+
+    // Postings of a term, by file and offset.
+    vector<Posting> find(string_view term) const;
+    // Terms starting with `prefix`, in order.
+    vector<string_view> termsWithPrefix(string_view prefix) const;
+    // Files with the term, in order.
+    vector<uint32_t> filesWith(string_view term) const;
+    // Files importing a module or any of its submodules.
+    vector<uint32_t> filesImporting(string_view module) const;
+
+    // Places in both lists, e.g. an attr:y where a kind:Attribute starts.
+    static vector<Posting> intersect(const vector<Posting>& a,
+                                     const vector<Posting>& b);
+
+private:
+    // index of the first term not less than `term`
+    size_t lowerBound(string_view term) const;
+    string_view termName(size_t i) const;
+    vector<Posting> postings(size_t i) const;
+
+private:
+    const char* data = nullptr;
+    size_t size = 0;
+};
@@ -0,0 +1,163 @@
+#include "Parser.h"
+#include "SearchIndex.h"
+#include "SourceFiles.h"
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+static void usage() {
+    fprintf(stderr,
+            "usage: pyser_search build INDEX [options] PATH...\n"
+            "       pyser_search find INDEX TERM...\n"
+            "       pyser_search files INDEX TERM\n"
+            "       pyser_search imports INDEX MODULE\n"
+            "build indexes the .py files given or found under the "
+            "directories given:\n"
+            "  --files-from FILE  more paths, one per line\n"
+            "  --jobs, -j N       threads, 0 for one per core (1)\n"
+            "  --timeout-ms N     time allowed to parse a file, none by "
+            "default\n"
+            "  --max-steps N      parser steps allowed per file\n"
+            "  --max-depth N      nesting allowed in a file (3000)\n"
+            "find prints the places all TERMs start at, files the files "
+            "with TERM,\n"
+            "imports the files importing MODULE or a submodule. Terms are "
+            "name:ID,\n"
+            "attr:ATTR, use:A.B, call:A.B, import:MODULE and kind:CLASS.\n");
+}
+
+static int build(const string& indexPath, int argc, char* argv[]) {
+    unsigned jobs = 1;
+    ParseLimits limits;
+    limits.maxDepth = ParseLimits::safeDepth;
+    long timeoutMs = 0;
+    vector<string> paths;
+    for (int i = 0; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--files-from" && i + 1 < argc) {
+            if (!addPathsFrom(argv[++i], paths)) {
+                fprintf(stderr, "cannot open %s\n", argv[i]);
+                return 2;
+            }
+        } else if ((arg == "--jobs" || arg == "-j") && i + 1 < argc) {
+            int n = atoi(argv[++i]);
+            jobs = n > 0 ? unsigned(n) : std::thread::hardware_concurrency();
+        } else if (arg == "--timeout-ms" && i + 1 < argc) {
+            timeoutMs = atol(argv[++i]);
+        } else if (arg == "--max-steps" && i + 1 < argc) {
+            limits.maxSteps = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--max-depth" && i + 1 < argc) {
+            limits.maxDepth = atoi(argv[++i]);
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            fprintf(stderr, "unknown option: %s\n", argv[i]);
+            return 2;
+        } else {
+            addPath(arg, paths);
+        }
+    }
+    jobs = max(1u, min<unsigned>(jobs, unsigned(paths.size())));
+
+    // files are parsed on any thread but added to the index in order, the
+    // first thread to find the next one ready adding it
+    SearchIndexBuilder builder;
+    std::mutex builderMutex;
+    vector<optional<vector<TermAt>>> done(paths.size());
+    size_t added = 0;
+    atomic<size_t> unreadable{0};
+    atomic<size_t> broken{0};
+    vector<optional<Parser>> parsers(jobs);
+    WorkStealingPool pool(jobs);
+    pool.runInOrder(paths.size(), [&](size_t i) {
+        vector<TermAt> terms;
+        string source;
+        if (readFile(paths[i], source)) {
+            optional<Parser>& parser = parsers[WorkStealingPool::worker()];
+            if (!parser) {
+                parser.emplace();
+            }
+            // a file over a limit is broken, what was parsed of it still
+            // indexed
+            ParseLimits fileLimits = limits;
+            if (timeoutMs > 0) {
+                fileLimits.deadline = std::chrono::steady_clock::now() +
+                                      std::chrono::milliseconds(timeoutMs);
+            }
+            ParseResult result = parser->parse(source, fileLimits);
+            if (!result.ok()) {
+                broken++;
+            }
+            indexTerms(*result.module, terms);
+        } else {
+            fprintf(stderr, "cannot open %s\n", paths[i].c_str());
+            unreadable++;
+        }
+        std::lock_guard<std::mutex> lock(builderMutex);
+        done[i] = move(terms);
+        for (; added < done.size() && done[added]; added++) {
+            builder.addFile(paths[added], *done[added]);
+            done[added].reset();
+        }
+    });
+
+    string error;
+    if (!builder.write(indexPath, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 2;
+    }
+    fprintf(stderr, "%zu files, %zu with errors\n", paths.size() - unreadable,
+            size_t(broken));
+    return unreadable ? 1 : 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 4 && !(argc == 3 && string(argv[1]) == "build")) {
+        usage();
+        return 2;
+    }
+    string command = argv[1];
+    string indexPath = argv[2];
+    if (command == "build") {
+        return build(indexPath, argc - 3, argv + 3);
+    }
+
+    SearchIndex index;
+    string error;
+    if (!index.open(indexPath, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 2;
+    }
+    vector<uint32_t> files;
+    if (command == "find") {
+        vector<Posting> found = index.find(argv[3]);
+        for (int i = 4; i < argc; i++) {
+            found = SearchIndex::intersect(found, index.find(argv[i]));
+        }
+        for (const Posting& p : found) {
+            string_view path = index.path(p.file);
+            printf("%.*s %u\n", int(path.size()), path.data(), p.offset);
+        }
+        return found.empty();
+    } else if (command == "files" && argc == 4) {
+        files = index.filesWith(argv[3]);
+    } else if (command == "imports" && argc == 4) {
+        files = index.filesImporting(argv[3]);
+    } else {
+        usage();
+        return 2;
+    }
+    for (uint32_t f : files) {
+        string_view path = index.path(f);
+        printf("%.*s\n", int(path.size()), path.data());
+    }
+    return files.empty();
+}
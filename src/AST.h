@@ -1,7 +1,11 @@
 #pragma once
 
+#include "AllocStats.h"
+#include "StringLiteral.h"
 #include "Visitor.h"
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <vector>
@@ -31,28 +35,143 @@ enum class operator_ {
 enum class unaryop { Invert, Not, UAdd, USub };
 enum class cmpop { Eq, NotEq, Lt, LtE, Gt, GtE, Is, IsNot, In, NotIn };
 
+// Every concrete node class, in NodeKind order.
+#define PYSER_AST_NODES(X)                                                     \
+    /* mod */                                                                  \
+    X(Module)                                                                  \
+    /* stmt */                                                                 \
+    X(FunctionDef)                                                             \
+    X(ClassDef)                                                                \
+    X(Return)                                                                  \
+    X(Delete)                                                                  \
+    X(Assign)                                                                  \
+    X(AugAssign)                                                               \
+    X(AnnAssign)                                                               \
+    X(For)                                                                     \
+    X(While)                                                                   \
+    X(If)                                                                      \
+    X(With)                                                                    \
+    X(Raise)                                                                   \
+    X(Try)                                                                     \
+    X(Assert)                                                                  \
+    X(Import)                                                                  \
+    X(ImportFrom)                                                              \
+    X(Global)                                                                  \
+    X(Nonlocal)                                                                \
+    X(Expr)                                                                    \
+    X(Pass)                                                                    \
+    X(Break)                                                                   \
+    X(Continue)                                                                \
+    /* expr */                                                                 \
+    X(BoolOp)                                                                  \
+    X(NamedExpr)                                                               \
+    X(BinOp)                                                                   \
+    X(UnaryOp)                                                                 \
+    X(Lambda)                                                                  \
+    X(IfExp)                                                                   \
+    X(Dict)                                                                    \
+    X(Set)                                                                     \
+    X(Await)                                                                   \
+    X(Yield)                                                                   \
+    X(YieldFrom)                                                               \
+    X(Compare)                                                                 \
+    X(Call)                                                                    \
+    X(Num)                                                                     \
+    X(Str)                                                                     \
+    X(Bool)                                                                    \
+    X(None)                                                                    \
+    X(Attribute)                                                               \
+    X(Subscript)                                                               \
+    X(Starred)                                                                 \
+    X(Name)                                                                    \
+    X(List)                                                                    \
+    X(Tuple)                                                                   \
+    X(Slice)
+
+// Concrete class of a node, to tell nodes apart without RTTI.
+enum class NodeKind : uint8_t {
+#define PYSER_NODE_KIND(name) name,
+    PYSER_AST_NODES(PYSER_NODE_KIND)
+#undef PYSER_NODE_KIND
+};
+
+#define PYSER_NODE_COUNT(name) +1
+constexpr size_t NODE_KIND_COUNT = 0 PYSER_AST_NODES(PYSER_NODE_COUNT);
+#undef PYSER_NODE_COUNT
+
+inline const char* nodeKindName(NodeKind kind) {
+    static const char* const names[] = {
+#define PYSER_NODE_NAME(name) #name,
+        PYSER_AST_NODES(PYSER_NODE_NAME)
+#undef PYSER_NODE_NAME
+    };
+    return names[size_t(kind)];
+}
+
+// Byte offsets of the first character of a node and one past its last, in
+// the parsed input.
+class SourceSpan {
+public:
+    bool contains(uint32_t offset) const {
+        return begin <= offset && offset < end;
+    }
+
+public:
+    uint32_t begin = 0;
+    uint32_t end = 0;
+};
+
 class ast {
 public:
+    ast(NodeKind kind): kind(kind) {}
     virtual ~ast() = default;
     virtual void accept(Visitor& visitor) = 0;
+
+#ifdef PYSER_ALLOC_STATS
+    // node objects are charged to ALLOC_NODES whoever creates them
+    static void* operator new(size_t size) {
+        AllocScope scope(ALLOC_NODES);
+        return ::operator new(size);
+    }
+    static void operator delete(void* p) { ::operator delete(p); }
+#endif
+
+public:
+    NodeKind kind;
+    // set by the parser
+    SourceSpan span;
+    // structural hash of the subtree, see StructuralHash.h
+    uint64_t hash = 0;
 };
 
 class mod: public ast {
 public:
+    mod(NodeKind kind): ast(kind) {}
     virtual ~mod() = default;
 };
 
 class stmt: public ast {
 public:
+    stmt(NodeKind kind): ast(kind) {}
     virtual ~stmt() = default;
 };
 
 class expr: public ast {
 public:
+    expr(NodeKind kind): ast(kind) {}
     virtual ~expr() = default;
     virtual void set_expr_context(expr_context) { throw "not implemented"; }
 };
 
+// Base of the concrete node classes, tags them with their kind.
+template <NodeKind K, class Base> class Node: public Base {
+public:
+    static constexpr NodeKind Kind = K;
+    // mod, stmt or expr
+    typedef Base Category;
+    Node(): Base(K) {}
+};
+
 typedef unique_ptr<stmt> stmtP;
 typedef unique_ptr<expr> exprP;
 typedef vector<stmtP> stmtPs;
@@ -60,7 +179,31 @@ typedef vector<exprP> exprPs;
 typedef unique_ptr<arg> argP;
 typedef vector<unique_ptr<arg>> argPs;
 
-class Module: public mod {
+// Operator chains nest as deep as the input is long, so the nodes the
+// operator parser builds hand their operands to a per-thread worklist when
+// destroyed instead of freeing them recursively; the outermost destructor
+// drains it.
+class OperandReaper {
+public:
+    template <class... Operands> static void release(Operands&... operands) {
+        ((operands ? pending.push_back(move(operands)) : void()), ...);
+        if (draining) {
+            return;
+        }
+        draining = true;
+        while (!pending.empty()) {
+            exprP operand = move(pending.back());
+            pending.pop_back();
+        }
+        draining = false;
+    }
+
+private:
+    static inline thread_local vector<exprP> pending;
+    static inline thread_local bool draining = false;
+};
+
+class Module: public Node<NodeKind::Module, mod> {
 public:
     Module(stmtPs body): body(move(body)) {}
     void accept(Visitor& visitor) override { visitor.visit(*this); }
@@ -69,7 +212,7 @@ public:
     stmtPs body;
 };
 
-class Assign: public stmt {
+class Assign: public Node<NodeKind::Assign, stmt> {
 public:
     Assign(exprPs targets, exprP value)
         : targets(move(targets)), value(move(value)) {}
@@ -80,7 +223,7 @@ public:
     exprP value;
 };
 
-class While: public stmt {
+class While: public Node<NodeKind::While, stmt> {
 public:
     While(exprP test, stmtPs body, stmtPs orelse)
         : test(move(test)), body(move(body)), orelse(move(orelse)) {}
@@ -92,7 +235,7 @@ public:
     stmtPs orelse;
 };
 
-class If: public stmt {
+class If: public Node<NodeKind::If, stmt> {
 public:
     If(exprP test, stmtPs body, stmtPs orelse)
         : test(move(test)), body(move(body)), orelse(move(orelse)) {}
@@ -104,7 +247,7 @@ public:
     stmtPs orelse;
 };
 
-class Expr: public stmt {
+class Expr: public Node<NodeKind::Expr, stmt> {
 public:
     Expr(exprP value): value(move(value)) {}
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
@@ -113,10 +256,11 @@ public:
     exprP value;
 };
 
-class BinOp: public expr {
+class BinOp: public Node<NodeKind::BinOp, expr> {
 public:
     BinOp(exprP left, operator_ op, exprP right)
         : left(move(left)), op(op), right(move(right)) {}
+    ~BinOp() { OperandReaper::release(left, right); }
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
 
 public:
@@ -125,9 +269,10 @@ public:
     exprP right;
 };
 
-class UnaryOp: public expr {
+class UnaryOp: public Node<NodeKind::UnaryOp, expr> {
 public:
     UnaryOp(unaryop op, exprP operand): op(op), operand(move(operand)) {}
+    ~UnaryOp() { OperandReaper::release(operand); }
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
 
 public:
@@ -135,7 +280,7 @@ public:
     exprP operand;
 };
 
-class BoolOp: public expr {
+class BoolOp: public Node<NodeKind::BoolOp, expr> {
 public:
     BoolOp(boolop op, exprPs values): op(op), values(move(values)) {}
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
@@ -145,7 +290,7 @@ public:
     vector<exprP> values;
 };
 
-class Compare: public expr {
+class Compare: public Node<NodeKind::Compare, expr> {
 public:
     Compare(exprP left, vector<cmpop> ops, exprPs comparators)
         : left(move(left)), ops(ops), comparators(move(comparators)) {}
@@ -157,7 +302,7 @@ public:
     exprPs comparators;
 };
 
-class Num: public expr {
+class Num: public Node<NodeKind::Num, expr> {
 public:
     Num(const string& value): value(value) {}
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
@@ -166,18 +311,35 @@ public:
     string value;
 };
 
-class Str: public expr {
+class Str: public Node<NodeKind::Str, expr> {
 public:
-    Str(const string& value, const optional<string>& kind)
-        : value(value), kind(kind) {}
+    Str(const string& value, const optional<string>& kind, uint8_t flags = 0)
+        : value(value), kind(kind), flags(flags) {}
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
 
+    // Escapes are only resolved on first use, most consumers never need
+    // more than the literal as written. Safe to call from several threads.
+    const string& decoded() {
+        std::call_once(decodeOnce, [this] {
+            decodedValue = decodeStringLiteral(value, flags);
+        });
+        return *decodedValue;
+    }
+
 public:
+    // literal as written, prefix and quotes included
     string value;
     optional<string> kind;
+    // combination of StrFlag
+    uint8_t flags;
+    // set once, by decoded()
+    optional<string> decodedValue;
+
+private:
+    std::once_flag decodeOnce;
 };
 
-class Bool: public expr {
+class Bool: public Node<NodeKind::Bool, expr> {
 public:
     Bool(string value): value(value) {}
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
@@ -186,13 +348,13 @@ public:
     string value;
 };
 
-class None: public expr {
+class None: public Node<NodeKind::None, expr> {
 public:
     None() {}
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
 };
 
-class Name: public expr {
+class Name: public Node<NodeKind::Name, expr> {
 public:
     Name(const string& id, const expr_context& ctx): id(id), ctx(ctx) {}
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
@@ -205,19 +367,21 @@ public:
     expr_context ctx;
 };
 
-class Await: public expr {
+class Await: public Node<NodeKind::Await, expr> {
 public:
     Await(exprP value): value(move(value)) {}
+    ~Await() { OperandReaper::release(value); }
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
 
 public:
     exprP value;
 };
 
-class Attribute: public expr {
+class Attribute: public Node<NodeKind::Attribute, expr> {
 public:
     Attribute(exprP value, const string& attr, expr_context ctx)
         : value(move(value)), attr(attr), ctx(ctx) {}
+    ~Attribute() { OperandReaper::release(value); }
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
     virtual void set_expr_context(expr_context ctx) override {
         this->ctx = ctx;
@@ -229,10 +393,11 @@ public:
     expr_context ctx;
 };
 
-class Subscript: public expr {
+class Subscript: public Node<NodeKind::Subscript, expr> {
 public:
     Subscript(exprP value, exprP slice, expr_context ctx)
         : value(move(value)), slice(move(slice)), ctx(ctx) {}
+    ~Subscript() { OperandReaper::release(value, slice); }
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
     virtual void set_expr_context(expr_context ctx) override {
         this->ctx = ctx;
@@ -244,7 +409,7 @@ public:
     expr_context ctx;
 };
 
-class Call: public expr {
+class Call: public Node<NodeKind::Call, expr> {
 public:
     Call(exprP func, exprPs args, vector<unique_ptr<keyword>> keywords)
         : func(move(func)), args(move(args)), keywords(move(keywords)) {}
@@ -256,7 +421,7 @@ public:
     vector<unique_ptr<keyword>> keywords;
 };
 
-class List: public expr {
+class List: public Node<NodeKind::List, expr> {
 public:
     List(exprPs elts, expr_context ctx): elts(move(elts)), ctx(ctx) {}
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
@@ -269,7 +434,7 @@ public:
     expr_context ctx;
 };
 
-class Tuple: public expr {
+class Tuple: public Node<NodeKind::Tuple, expr> {
 public:
     Tuple(exprPs elts, expr_context ctx): elts(move(elts)), ctx(ctx) {}
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
@@ -282,7 +447,7 @@ public:
     expr_context ctx;
 };
 
-class Slice: public expr {
+class Slice: public Node<NodeKind::Slice, expr> {
 public:
     Slice(exprP lower, exprP upper, exprP step)
         : lower(move(lower)), upper(move(upper)), step(move(step)) {}
@@ -294,7 +459,7 @@ public:
     exprP step;
 };
 
-class FunctionDef: public stmt {
+class FunctionDef: public Node<NodeKind::FunctionDef, stmt> {
 public:
     FunctionDef(const string& name, unique_ptr<arguments> args, stmtPs body,
                 exprPs decorator_list, exprP returns)
@@ -310,7 +475,7 @@ public:
     exprP returns;
 };
 
-class ClassDef: public stmt {
+class ClassDef: public Node<NodeKind::ClassDef, stmt> {
 public:
     ClassDef(const string& name, exprPs bases, stmtPs body,
              exprPs decorator_list)
@@ -326,7 +491,7 @@ public:
     exprPs decorator_list;
 };
 
-class Return: public stmt {
+class Return: public Node<NodeKind::Return, stmt> {
 public:
     Return(exprP value): value(move(value)) {}
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
@@ -335,7 +500,7 @@ public:
     exprP value;
 };
 
-class Delete: public stmt {
+class Delete: public Node<NodeKind::Delete, stmt> {
 public:
     Delete(exprPs targets): targets(move(targets)) {}
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
@@ -344,7 +509,7 @@ public:
     exprPs targets;
 };
 
-class AugAssign: public stmt {
+class AugAssign: public Node<NodeKind::AugAssign, stmt> {
 public:
     AugAssign(exprP target, operator_ op, exprP value)
         : target(move(target)), op(op), value(move(value)) {}
@@ -356,7 +521,7 @@ public:
     exprP value;
 };
 
-class AnnAssign: public stmt {
+class AnnAssign: public Node<NodeKind::AnnAssign, stmt> {
 public:
     AnnAssign(exprP target, exprP annotation, exprP value, int simple)
         : target(move(target)), annotation(move(annotation)),
@@ -370,7 +535,7 @@ public:
     int simple;
 };
 
-class For: public stmt {
+class For: public Node<NodeKind::For, stmt> {
 public:
     For(exprP target, exprP iter, stmtPs body, stmtPs orelse)
         : target(move(target)), iter(move(iter)), body(move(body)),
@@ -384,21 +549,21 @@ public:
     stmtPs orelse;
 };
 
-class With: public stmt {
+class With: public Node<NodeKind::With, stmt> {
 public:
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
 
 public:
 };
 
-class Raise: public stmt {
+class Raise: public Node<NodeKind::Raise, stmt> {
 public:
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
 
 public:
 };
 
-class Try: public stmt {
+class Try: public Node<NodeKind::Try, stmt> {
 public:
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
 
@@ -407,7 +572,7 @@ public:
     exprP cause;
 };
 
-class Assert: public stmt {
+class Assert: public Node<NodeKind::Assert, stmt> {
 public:
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
     Assert(exprP test, exprP msg): test(move(test)), msg(move(msg)) {}
@@ -417,7 +582,7 @@ public:
     exprP msg;
 };
 
-class Import: public stmt {
+class Import: public Node<NodeKind::Import, stmt> {
 public:
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
     Import(std::vector<alias> aliases): names(move(aliases)) {}
@@ -426,7 +591,7 @@ public:
     std::vector<alias> names;
 };
 
-class ImportFrom: public stmt {
+class ImportFrom: public Node<NodeKind::ImportFrom, stmt> {
 public:
     ImportFrom(optional<string> module, std::vector<alias> aliases, int level)
         : module(move(module)), aliases(move(aliases)), level(std::move(level)) {}
@@ -438,52 +603,53 @@ public:
     int level;
 };
 
-class Global: public stmt {
+class Global: public Node<NodeKind::Global, stmt> {
 public:
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
 
 public:
 };
 
-class Nonlocal: public stmt {
+class Nonlocal: public Node<NodeKind::Nonlocal, stmt> {
 public:
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
 
 public:
 };
 
-class Pass: public stmt {
+class Pass: public Node<NodeKind::Pass, stmt> {
 public:
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
 
 public:
 };
 
-class Break: public stmt {
+class Break: public Node<NodeKind::Break, stmt> {
 public:
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
 
 public:
 };
 
-class Continue: public stmt {
+class Continue: public Node<NodeKind::Continue, stmt> {
 public:
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
 
 public:
 };
 
-class Lambda: public expr {
+class Lambda: public Node<NodeKind::Lambda, expr> {
 public:
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
 
 public:
 };
 
-class IfExp: public expr {
+class IfExp: public Node<NodeKind::IfExp, expr> {
 public:
     IfExp(exprP test, exprP body, exprP orelse)
         : test(move(test)), body(move(body)), orelse(move(orelse)) {}
+    ~IfExp() { OperandReaper::release(test, body, orelse); }
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
 
 public:
@@ -492,21 +658,21 @@ public:
     exprP orelse;
 };
 
-class Dict: public expr {
+class Dict: public Node<NodeKind::Dict, expr> {
 public:
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
 
 public:
 };
 
-class Set: public expr {
+class Set: public Node<NodeKind::Set, expr> {
 public:
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
 
 public:
 };
 
-class Yield: public expr {
+class Yield: public Node<NodeKind::Yield, expr> {
 public:
     Yield(exprP value): value(move(value)) {}
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
@@ -515,7 +681,7 @@ public:
     exprP value;
 };
 
-class YieldFrom: public expr {
+class YieldFrom: public Node<NodeKind::YieldFrom, expr> {
 public:
     YieldFrom(exprP value): value(move(value)) {}
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
@@ -524,9 +690,10 @@ public:
     exprP value;
 };
 
-class Starred: public expr {
+class Starred: public Node<NodeKind::Starred, expr> {
 public:
     Starred(exprP value, expr_context ctx): value(move(value)), ctx(ctx) {}
+    ~Starred() { OperandReaper::release(value); }
     virtual void accept(Visitor& visitor) override { visitor.visit(*this); }
     virtual void set_expr_context(expr_context ctx) override {
         this->ctx = ctx;
@@ -601,7 +768,7 @@ public:
     exprP optional_vars;
 };
 
-class NamedExpr: public expr {
+class NamedExpr: public Node<NodeKind::NamedExpr, expr> {
 public:
     NamedExpr(exprP target, exprP value)
         : target(move(target)), value(move(value)) {}
@@ -0,0 +1,146 @@
+#include "AllocStats.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+using std::atomic;
+
+namespace {
+
+atomic<uint64_t> allocations[ALLOC_TAG_COUNT];
+atomic<uint64_t> allocatedBytes[ALLOC_TAG_COUNT];
+atomic<uint64_t> live{0};
+atomic<uint64_t> peak{0};
+
+} // namespace
+
+const char* allocTagName(AllocTag tag) {
+    switch (tag) {
+    case ALLOC_OTHER:
+        return "other";
+    case ALLOC_TOKENIZER:
+        return "tokenizer";
+    case ALLOC_PARSER:
+        return "parser";
+    case ALLOC_NODES:
+        return "nodes";
+    case ALLOC_PRINTER:
+        return "printer";
+    default:
+        return "unknown";
+    }
+}
+
+AllocCounts AllocStats::counts() {
+    AllocCounts c;
+    for (int i = 0; i < ALLOC_TAG_COUNT; i++) {
+        c.allocations[i] = allocations[i].load(std::memory_order_relaxed);
+        c.bytes[i] = allocatedBytes[i].load(std::memory_order_relaxed);
+    }
+    return c;
+}
+
+uint64_t AllocStats::liveBytes() { return live.load(); }
+
+uint64_t AllocStats::peakLiveBytes() { return peak.load(); }
+
+void AllocStats::resetPeak() { peak.store(live.load()); }
+
+#ifdef PYSER_ALLOC_STATS
+
+namespace {
+
+// Stored right before every block handed out, to know its size on delete.
+struct alignas(16) BlockHeader {
+    uint64_t size;
+    // from the start of the underlying allocation to the block
+    uint32_t offset;
+};
+
+void* allocate(size_t size, size_t align) {
+    size_t offset = align > sizeof(BlockHeader) ? align : sizeof(BlockHeader);
+    char* base;
+    if (align > alignof(std::max_align_t)) {
+        // aligned_alloc wants a multiple of the alignment
+        size_t total = (offset + size + align - 1) / align * align;
+        base = static_cast<char*>(aligned_alloc(align, total));
+    } else {
+        base = static_cast<char*>(malloc(offset + size));
+    }
+    if (!base) {
+        return nullptr;
+    }
+    char* block = base + offset;
+    BlockHeader* header = reinterpret_cast<BlockHeader*>(block) - 1;
+    header->size = size;
+    header->offset = uint32_t(offset);
+
+    AllocTag tag = AllocStats::current;
+    allocations[tag].fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes[tag].fetch_add(size, std::memory_order_relaxed);
+    uint64_t now = live.fetch_add(size, std::memory_order_relaxed) + size;
+    uint64_t top = peak.load(std::memory_order_relaxed);
+    while (now > top && !peak.compare_exchange_weak(top, now)) {
+    }
+    return block;
+}
+
+void deallocate(void* p) {
+    if (!p) {
+        return;
+    }
+    BlockHeader* header = static_cast<BlockHeader*>(p) - 1;
+    live.fetch_sub(header->size, std::memory_order_relaxed);
+    free(static_cast<char*>(p) - header->offset);
+}
+
+void* allocateOrThrow(size_t size, size_t align) {
+    void* p = allocate(size, align);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+    return allocateOrThrow(size, alignof(std::max_align_t));
+}
+void* operator new[](size_t size) {
+    return allocateOrThrow(size, alignof(std::max_align_t));
+}
+void* operator new(size_t size, std::align_val_t align) {
+    return allocateOrThrow(size, size_t(align));
+}
+void* operator new[](size_t size, std::align_val_t align) {
+    return allocateOrThrow(size, size_t(align));
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size, alignof(std::max_align_t));
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size, alignof(std::max_align_t));
+}
+
+void operator delete(void* p) noexcept { deallocate(p); }
+void operator delete[](void* p) noexcept { deallocate(p); }
+void operator delete(void* p, size_t) noexcept { deallocate(p); }
+void operator delete[](void* p, size_t) noexcept { deallocate(p); }
+void operator delete(void* p, std::align_val_t) noexcept { deallocate(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { deallocate(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept {
+    deallocate(p);
+}
+void operator delete[](void* p, size_t, std::align_val_t) noexcept {
+    deallocate(p);
+}
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    deallocate(p);
+}
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    deallocate(p);
+}
+
+#endif
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+
+// Subsystem an allocation is charged to.
+enum AllocTag : uint8_t {
+    ALLOC_OTHER,
+    ALLOC_TOKENIZER,
+    // everything the parser allocates apart from the nodes themselves:
+    // token copies, child vectors, strings
+    ALLOC_PARSER,
+    ALLOC_NODES,
+    ALLOC_PRINTER,
+    ALLOC_TAG_COUNT,
+};
+
+const char* allocTagName(AllocTag tag);
+
+class AllocCounts {
+public:
+    AllocCounts operator-(const AllocCounts& other) const {
+        AllocCounts d;
+        for (int i = 0; i < ALLOC_TAG_COUNT; i++) {
+            d.allocations[i] = allocations[i] - other.allocations[i];
+            d.bytes[i] = bytes[i] - other.bytes[i];
+        }
+        return d;
+    }
+
+    AllocCounts& operator+=(const AllocCounts& other) {
+        for (int i = 0; i < ALLOC_TAG_COUNT; i++) {
+            allocations[i] += other.allocations[i];
+            bytes[i] += other.bytes[i];
+        }
+        return *this;
+    }
+
+    uint64_t totalAllocations() const {
+        uint64_t n = 0;
+        for (uint64_t a : allocations) {
+            n += a;
+        }
+        return n;
+    }
+
+public:
+    uint64_t allocations[ALLOC_TAG_COUNT] = {};
+    uint64_t bytes[ALLOC_TAG_COUNT] = {};
+};
+
+// Counts every allocation of the process by the tag of the innermost
+// AllocScope of the allocating thread. Only builds with PYSER_ALLOC_STATS
+// replace the global operator new; elsewhere the counts stay zero and
+// scopes compile to nothing.
+class AllocStats {
+public:
+#ifdef PYSER_ALLOC_STATS
+    static constexpr bool enabled = true;
+#else
+    static constexpr bool enabled = false;
+#endif
+
+    // Allocations made since the start.
+    static AllocCounts counts();
+    static uint64_t liveBytes();
+    static uint64_t peakLiveBytes();
+    // Restarts peak tracking from the current live heap.
+    static void resetPeak();
+
+public:
+    static inline thread_local AllocTag current = ALLOC_OTHER;
+};
+
+#ifdef PYSER_ALLOC_STATS
+
+class AllocScope {
+public:
+    AllocScope(AllocTag tag): saved(AllocStats::current) {
+        AllocStats::current = tag;
+    }
+    ~AllocScope() { AllocStats::current = saved; }
+
+private:
+    AllocTag saved;
+};
+
+#else
+
+class AllocScope {
+public:
+    AllocScope(AllocTag) {}
+};
+
+#endif
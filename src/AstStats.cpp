@@ -0,0 +1,293 @@
+#include "AstStats.h"
+#include <algorithm>
+#include <vector>
+
+void NodeCounter::visit(Module& node) {
+    count(node, "Module", held(node.body));
+    walk(node.body);
+}
+
+void NodeCounter::visit(FunctionDef& node) {
+    count(node, "FunctionDef", held(node.name, node.body, node.decorator_list));
+    walk(node.args);
+    walk(node.body);
+    walk(node.decorator_list);
+    walk(node.returns);
+}
+
+void NodeCounter::visit(ClassDef& node) {
+    count(node, "ClassDef",
+          held(node.name, node.bases, node.keywords, node.body,
+               node.decorator_list));
+    walk(node.bases);
+    walk(node.keywords);
+    walk(node.body);
+    walk(node.decorator_list);
+}
+
+void NodeCounter::visit(Return& node) {
+    count(node, "Return");
+    walk(node.value);
+}
+
+void NodeCounter::visit(Delete& node) {
+    count(node, "Delete", held(node.targets));
+    walk(node.targets);
+}
+
+void NodeCounter::visit(Assign& node) {
+    count(node, "Assign", held(node.targets));
+    walk(node.targets);
+    walk(node.value);
+}
+
+void NodeCounter::visit(AugAssign& node) {
+    count(node, "AugAssign");
+    walk(node.target);
+    walk(node.value);
+}
+
+void NodeCounter::visit(AnnAssign& node) {
+    count(node, "AnnAssign");
+    walk(node.target);
+    walk(node.annotation);
+    walk(node.value);
+}
+
+void NodeCounter::visit(For& node) {
+    count(node, "For", held(node.body, node.orelse));
+    walk(node.target);
+    walk(node.iter);
+    walk(node.body);
+    walk(node.orelse);
+}
+
+void NodeCounter::visit(While& node) {
+    count(node, "While", held(node.body, node.orelse));
+    walk(node.test);
+    walk(node.body);
+    walk(node.orelse);
+}
+
+void NodeCounter::visit(If& node) {
+    count(node, "If", held(node.body, node.orelse));
+    walk(node.test);
+    walk(node.body);
+    walk(node.orelse);
+}
+
+void NodeCounter::visit(Try& node) {
+    count(node, "Try");
+    walk(node.exc);
+    walk(node.cause);
+}
+
+void NodeCounter::visit(Assert& node) {
+    count(node, "Assert");
+    walk(node.test);
+    walk(node.msg);
+}
+
+void NodeCounter::visit(Import& node) {
+    count(node, "Import", held(node.names));
+    walk(node.names);
+}
+
+void NodeCounter::visit(ImportFrom& node) {
+    count(node, "ImportFrom", held(node.module, node.aliases));
+    walk(node.aliases);
+}
+
+void NodeCounter::visit(Expr& node) {
+    count(node, "Expr");
+    walk(node.value);
+}
+
+void NodeCounter::visit(BoolOp& node) {
+    count(node, "BoolOp", held(node.values));
+    walk(node.values);
+}
+
+void NodeCounter::visit(NamedExpr& node) {
+    count(node, "NamedExpr");
+    walk(node.target);
+    walk(node.value);
+}
+
+void NodeCounter::visit(BinOp& node) {
+    count(node, "BinOp");
+    walk(node.left);
+    walk(node.right);
+}
+
+void NodeCounter::visit(UnaryOp& node) {
+    count(node, "UnaryOp");
+    walk(node.operand);
+}
+
+void NodeCounter::visit(IfExp& node) {
+    count(node, "IfExp");
+    walk(node.test);
+    walk(node.body);
+    walk(node.orelse);
+}
+
+void NodeCounter::visit(Await& node) {
+    count(node, "Await");
+    walk(node.value);
+}
+
+void NodeCounter::visit(Yield& node) {
+    count(node, "Yield");
+    walk(node.value);
+}
+
+void NodeCounter::visit(YieldFrom& node) {
+    count(node, "YieldFrom");
+    walk(node.value);
+}
+
+void NodeCounter::visit(Compare& node) {
+    count(node, "Compare", held(node.ops, node.comparators));
+    walk(node.left);
+    walk(node.comparators);
+}
+
+void NodeCounter::visit(Call& node) {
+    count(node, "Call", held(node.args, node.keywords));
+    walk(node.func);
+    walk(node.args);
+    walk(node.keywords);
+}
+
+void NodeCounter::visit(Attribute& node) {
+    count(node, "Attribute", held(node.attr));
+    walk(node.value);
+}
+
+void NodeCounter::visit(Subscript& node) {
+    count(node, "Subscript");
+    walk(node.value);
+    walk(node.slice);
+}
+
+void NodeCounter::visit(Starred& node) {
+    count(node, "Starred");
+    walk(node.value);
+}
+
+void NodeCounter::visit(List& node) {
+    count(node, "List", held(node.elts));
+    walk(node.elts);
+}
+
+void NodeCounter::visit(Tuple& node) {
+    count(node, "Tuple", held(node.elts));
+    walk(node.elts);
+}
+
+void NodeCounter::visit(Slice& node) {
+    count(node, "Slice");
+    walk(node.lower);
+    walk(node.upper);
+    walk(node.step);
+}
+
+void NodeCounter::visit(arguments& node) {
+    count(node, "arguments",
+          held(node.posonlyargs, node.args, node.kwonlyargs, node.kw_defaults,
+               node.defaults));
+    walk(node.posonlyargs);
+    walk(node.args);
+    walk(node.vararg);
+    walk(node.kwonlyargs);
+    walk(node.kw_defaults);
+    walk(node.kwarg);
+    walk(node.defaults);
+}
+
+void NodeCounter::visit(arg& node) {
+    count(node, "arg", held(node.argu));
+    walk(node.annotation);
+}
+
+void NodeCounter::visit(keyword& node) {
+    count(node, "keyword", held(node.arg));
+    walk(node.value);
+}
+
+void NodeCounter::visit(withitem& node) {
+    count(node, "withitem");
+    walk(node.context_expr);
+    walk(node.optional_vars);
+}
+
+void NodeCounter::visit(With& node) { count(node, "With"); }
+
+void NodeCounter::visit(Raise& node) { count(node, "Raise"); }
+
+void NodeCounter::visit(Global& node) { count(node, "Global"); }
+
+void NodeCounter::visit(Nonlocal& node) { count(node, "Nonlocal"); }
+
+void NodeCounter::visit(Pass& node) { count(node, "Pass"); }
+
+void NodeCounter::visit(Break& node) { count(node, "Break"); }
+
+void NodeCounter::visit(Continue& node) { count(node, "Continue"); }
+
+void NodeCounter::visit(Lambda& node) { count(node, "Lambda"); }
+
+void NodeCounter::visit(Dict& node) { count(node, "Dict"); }
+
+void NodeCounter::visit(Set& node) { count(node, "Set"); }
+
+void NodeCounter::visit(Str& node) {
+    count(node, "Str", held(node.value, node.kind, node.decodedValue));
+}
+
+void NodeCounter::visit(Num& node) { count(node, "Num", held(node.value)); }
+
+void NodeCounter::visit(Bool& node) { count(node, "Bool", held(node.value)); }
+
+void NodeCounter::visit(None& node) { count(node, "None"); }
+
+void NodeCounter::visit(Name& node) { count(node, "Name", held(node.id)); }
+
+// aliases are stored by value in the vectors of Import and ImportFrom
+void NodeCounter::visit(alias& node) {
+    count(node, "alias", held(node.name, node.asname), false);
+}
+
+void writeFootprint(FILE* out, const map<string, NodeClassStats>& classes) {
+    std::vector<std::pair<string, NodeClassStats>> rows(classes.begin(),
+                                                        classes.end());
+    auto bytes = [](const NodeClassStats& c) {
+        return c.objectBytes + c.heapBytes;
+    };
+    std::sort(rows.begin(), rows.end(), [&](const auto& a, const auto& b) {
+        return bytes(a.second) > bytes(b.second);
+    });
+
+    NodeClassStats total;
+    fprintf(out, "%-16s %10s %7s %12s %12s %12s %12s\n", "class", "count",
+            "sizeof", "objects", "heap", "wasted", "total");
+    for (const auto& [name, c] : rows) {
+        fprintf(out, "%-16s %10llu %7zu %12llu %12llu %12llu %12llu\n",
+                name.c_str(), (unsigned long long)c.count, c.size,
+                (unsigned long long)c.objectBytes,
+                (unsigned long long)c.heapBytes,
+                (unsigned long long)c.wastedBytes,
+                (unsigned long long)bytes(c));
+        total.count += c.count;
+        total.objectBytes += c.objectBytes;
+        total.heapBytes += c.heapBytes;
+        total.wastedBytes += c.wastedBytes;
+    }
+    fprintf(out, "%-16s %10llu %7s %12llu %12llu %12llu %12llu\n", "total",
+            (unsigned long long)total.count, "",
+            (unsigned long long)total.objectBytes,
+            (unsigned long long)total.heapBytes,
+            (unsigned long long)total.wastedBytes,
+            (unsigned long long)bytes(total));
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+#include "AST.h"
+#include "StaticVisitor.h"
+#include "Visitor.h"
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <type_traits>
+
+using std::map;
+using std::string;
+
+class NodeClassStats {
+public:
+    NodeClassStats& operator+=(const NodeClassStats& other) {
+        count += other.count;
+        size = other.size ? other.size : size;
+        objectBytes += other.objectBytes;
+        heapBytes += other.heapBytes;
+        wastedBytes += other.wastedBytes;
+        return *this;
+    }
+
+public:
+    uint64_t count = 0;
+    // 0 for classes that are only declared
+    size_t size = 0;
+    // bytes of the objects themselves, unless they live inside a vector
+    uint64_t objectBytes = 0;
+    // held by their strings and vectors
+    uint64_t heapBytes = 0;
+    // unused vector capacity, part of heapBytes
+    uint64_t wastedBytes = 0;
+};
+
+// Counts the nodes of a tree per AST class, walking every child, along with
+// the memory each class takes.
+class NodeCounter final: public Visitor, public StaticVisitor<NodeCounter> {
+public:
+    map<string, NodeClassStats> classes;
+    uint64_t total = 0;
+
+public:
+    virtual void visit(Module&) override;
+    virtual void visit(Interactive&) override { count("Interactive"); }
+    virtual void visit(Expression&) override { count("Expression"); }
+    virtual void visit(FunctionType&) override { count("FunctionType"); }
+    virtual void visit(FunctionDef&) override;
+    virtual void visit(AsyncFunctionDef&) override {
+        count("AsyncFunctionDef");
+    }
+    virtual void visit(ClassDef&) override;
+    virtual void visit(Return&) override;
+    virtual void visit(Delete&) override;
+    virtual void visit(Assign&) override;
+    virtual void visit(AugAssign&) override;
+    virtual void visit(AnnAssign&) override;
+    virtual void visit(For&) override;
+    virtual void visit(AsyncFor&) override { count("AsyncFor"); }
+    virtual void visit(While&) override;
+    virtual void visit(If&) override;
+    virtual void visit(With&) override;
+    virtual void visit(AsyncWith&) override { count("AsyncWith"); }
+    virtual void visit(Match&) override { count("Match"); }
+    virtual void visit(Raise&) override;
+    virtual void visit(Try&) override;
+    virtual void visit(Assert&) override;
+    virtual void visit(Import&) override;
+    virtual void visit(ImportFrom&) override;
+    virtual void visit(Global&) override;
+    virtual void visit(Nonlocal&) override;
+    virtual void visit(Expr&) override;
+    virtual void visit(Pass&) override;
+    virtual void visit(Break&) override;
+    virtual void visit(Continue&) override;
+    virtual void visit(BoolOp&) override;
+    virtual void visit(NamedExpr&) override;
+    virtual void visit(BinOp&) override;
+    virtual void visit(UnaryOp&) override;
+    virtual void visit(Lambda&) override;
+    virtual void visit(IfExp&) override;
+    virtual void visit(Dict&) override;
+    virtual void visit(Set&) override;
+    virtual void visit(ListComp&) override { count("ListComp"); }
+    virtual void visit(SetComp&) override { count("SetComp"); }
+    virtual void visit(DictComp&) override { count("DictComp"); }
+    virtual void visit(GeneratorExp&) override { count("GeneratorExp"); }
+    virtual void visit(Await&) override;
+    virtual void visit(Yield&) override;
+    virtual void visit(YieldFrom&) override;
+    virtual void visit(Compare&) override;
+    virtual void visit(Call&) override;
+    virtual void visit(FormattedValue&) override { count("FormattedValue"); }
+    virtual void visit(JoinedStr&) override { count("JoinedStr"); }
+    virtual void visit(Constant&) override { count("Constant"); }
+    virtual void visit(Str&) override;
+    virtual void visit(Num&) override;
+    virtual void visit(Bool&) override;
+    virtual void visit(None&) override;
+    virtual void visit(Attribute&) override;
+    virtual void visit(Subscript&) override;
+    virtual void visit(Starred&) override;
+    virtual void visit(Name&) override;
+    virtual void visit(List&) override;
+    virtual void visit(Tuple&) override;
+    virtual void visit(Slice&) override;
+    virtual void visit(comprehension&) override { count("comprehension"); }
+    virtual void visit(exceptHandler&) override { count("exceptHandler"); }
+    virtual void visit(arguments&) override;
+    virtual void visit(arg&) override;
+    virtual void visit(keyword&) override;
+    virtual void visit(alias&) override;
+    virtual void visit(withitem&) override;
+    virtual void visit(match_case&) override { count("match_case"); }
+    virtual void visit(MatchValue&) override { count("MatchValue"); }
+    virtual void visit(MatchSingleton&) override { count("MatchSingleton"); }
+    virtual void visit(MatchSequence&) override { count("MatchSequence"); }
+    virtual void visit(MatchMapping&) override { count("MatchMapping"); }
+    virtual void visit(MatchClass&) override { count("MatchClass"); }
+    virtual void visit(MatchStar&) override { count("MatchStar"); }
+    virtual void visit(MatchAs&) override { count("MatchAs"); }
+    virtual void visit(MatchOr&) override { count("MatchOr"); }
+    virtual void visit(type_ignore&) override { count("type_ignore"); }
+
+private:
+    class Held {
+    public:
+        Held operator+(const Held& other) const {
+            return {heap + other.heap, wasted + other.wasted};
+        }
+
+    public:
+        uint64_t heap = 0;
+        uint64_t wasted = 0;
+    };
+
+    static Held held(const string& s) {
+        const char* p = s.data();
+        bool inline_ = p >= reinterpret_cast<const char*>(&s) &&
+                       p < reinterpret_cast<const char*>(&s + 1);
+        return {inline_ ? 0 : s.capacity() + 1, 0};
+    }
+
+    static Held held(const optional<string>& s) {
+        return s ? held(*s) : Held();
+    }
+
+    template <class T> static Held held(const vector<T>& v) {
+        return {v.capacity() * sizeof(T),
+                (v.capacity() - v.size()) * sizeof(T)};
+    }
+
+    template <class T, class... More>
+    static Held held(const T& first, const More&... more) {
+        return held(first) + held(more...);
+    }
+
+    // Only declared classes, nothing is known about their layout.
+    void count(const char* name) {
+        classes[name].count++;
+        total++;
+    }
+
+    template <class T>
+    void count(const T&, const char* name, Held held = Held(),
+               bool ownAllocation = true) {
+        NodeClassStats& c = classes[name];
+        c.count++;
+        c.size = sizeof(T);
+        if (ownAllocation) {
+            c.objectBytes += sizeof(T);
+        }
+        c.heapBytes += held.heap;
+        c.wastedBytes += held.wasted;
+        total++;
+    }
+
+    template <class T> void walk(unique_ptr<T>& node) {
+        if (node) {
+            if constexpr (std::is_base_of_v<ast, T>) {
+                dispatch(*node);
+            } else {
+                node->accept(*this);
+            }
+        }
+    }
+
+    template <class T> void walk(vector<T>& nodes) {
+        for (T& node : nodes) {
+            walk(node);
+        }
+    }
+
+    void walk(alias& node) { node.accept(*this); }
+};
+
+// Table of the classes by total bytes, largest first.
+void writeFootprint(FILE* out, const map<string, NodeClassStats>& classes);
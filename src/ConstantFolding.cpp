@@ -0,0 +1,163 @@
+#include "ConstantFolding.h"
+#include "RecursiveVisitor.h"
+#include <cstdint>
+#include <optional>
+
+using std::optional;
+
+namespace {
+
+optional<int64_t> valueOf(const expr& e) {
+    if (e.kind != NodeKind::Num) {
+        return std::nullopt;
+    }
+    const string& s = static_cast<const Num&>(e).value;
+    size_t i = s.size() && s[0] == '-' ? 1 : 0;
+    if (i == s.size()) {
+        return std::nullopt;
+    }
+    int64_t v = 0;
+    for (; i < s.size(); i++) {
+        if (s[i] < '0' || s[i] > '9' ||
+            __builtin_mul_overflow(v, 10, &v) ||
+            __builtin_sub_overflow(v, s[i] - '0', &v)) {
+            return std::nullopt;
+        }
+    }
+    // accumulated negative, INT64_MIN has no positive counterpart
+    if (s[0] != '-' && __builtin_mul_overflow(v, -1, &v)) {
+        return std::nullopt;
+    }
+    return v;
+}
+
+// a // b and a % b round towards negative infinity in Python
+int64_t floorDiv(int64_t a, int64_t b) {
+    int64_t q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+int64_t floorMod(int64_t a, int64_t b) {
+    int64_t r = a % b;
+    return (r != 0 && (r < 0) != (b < 0)) ? r + b : r;
+}
+
+optional<int64_t> power(int64_t base, int64_t exponent) {
+    int64_t result = 1;
+    while (exponent > 0) {
+        if ((exponent & 1) && __builtin_mul_overflow(result, base, &result)) {
+            return std::nullopt;
+        }
+        exponent >>= 1;
+        if (exponent && __builtin_mul_overflow(base, base, &base)) {
+            return std::nullopt;
+        }
+    }
+    return result;
+}
+
+optional<int64_t> apply(operator_ op, int64_t a, int64_t b) {
+    int64_t r;
+    switch (op) {
+    case operator_::Add:
+        return __builtin_add_overflow(a, b, &r) ? optional<int64_t>() : r;
+    case operator_::Sub:
+        return __builtin_sub_overflow(a, b, &r) ? optional<int64_t>() : r;
+    case operator_::Mult:
+        return __builtin_mul_overflow(a, b, &r) ? optional<int64_t>() : r;
+    case operator_::FloorDiv:
+    case operator_::Mod:
+        if (b == 0 || (a == INT64_MIN && b == -1)) {
+            return std::nullopt;
+        }
+        return op == operator_::Mod ? floorMod(a, b) : floorDiv(a, b);
+    case operator_::Pow:
+        // a negative exponent gives a float
+        if (b < 0) {
+            return std::nullopt;
+        }
+        return power(a, b);
+    case operator_::LShift:
+        if (b < 0) {
+            return std::nullopt;
+        }
+        if (a == 0) {
+            return 0;
+        }
+        if (b >= 63 || (a << b) >> b != a) {
+            return std::nullopt;
+        }
+        return a << b;
+    case operator_::RShift:
+        if (b < 0) {
+            return std::nullopt;
+        }
+        return b >= 63 ? (a < 0 ? -1 : 0) : a >> b;
+    case operator_::BitOr:
+        return a | b;
+    case operator_::BitXor:
+        return a ^ b;
+    case operator_::BitAnd:
+        return a & b;
+    case operator_::Div:
+    case operator_::MatMult:
+        break;
+    }
+    return std::nullopt;
+}
+
+class ConstantFolder: public Transformer<ConstantFolder> {
+public:
+    using Transformer<ConstantFolder>::replace;
+
+    exprP replace(BinOp& node) {
+        optional<int64_t> a = valueOf(*node.left);
+        optional<int64_t> b = a ? valueOf(*node.right) : std::nullopt;
+        if (!b) {
+            return nullptr;
+        }
+        return folded(node, apply(node.op, *a, *b));
+    }
+
+    exprP replace(UnaryOp& node) {
+        optional<int64_t> a = valueOf(*node.operand);
+        if (!a) {
+            return nullptr;
+        }
+        switch (node.op) {
+        case unaryop::UAdd:
+            return folded(node, a);
+        case unaryop::USub:
+            return folded(node, *a == INT64_MIN ? std::nullopt
+                                                : optional<int64_t>(-*a));
+        case unaryop::Invert:
+            return folded(node, ~*a);
+        case unaryop::Not:
+            break;
+        }
+        return nullptr;
+    }
+
+    size_t count = 0;
+
+private:
+    exprP folded(expr& node, optional<int64_t> value) {
+        if (!value) {
+            return nullptr;
+        }
+        count++;
+        exprP num = make_unique<Num>(std::to_string(*value));
+        num->span = node.span;
+        return num;
+    }
+};
+
+} // namespace
+
+size_t foldConstants(Module& module) {
+    ConstantFolder folder;
+    for (stmtP& s : module.body) {
+        folder.transform(s);
+    }
+    return folder.count;
+}
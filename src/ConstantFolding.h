@@ -0,0 +1,10 @@
+#pragma once
+
+#include "AST.h"
+
+// Folds integer arithmetic on literals in place, as CPython's compiler
+// does: `-1`, `2 ** 10` and `1 << 4 | 1` become single Num nodes spanning
+// what they replace. Operations Python evaluates to a float or to an error,
+// and results out of 64-bit range, are left as written. Returns the number
+// of nodes folded. Structural hashes are not updated.
+size_t foldConstants(Module& module);
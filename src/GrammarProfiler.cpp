@@ -0,0 +1,71 @@
+#include "GrammarProfiler.h"
+#include <algorithm>
+#include <mutex>
+#include <string>
+
+using std::string;
+
+namespace {
+
+std::mutex rulesMutex;
+vector<const char*> ruleNames;
+thread_local vector<RuleStats> localStats;
+
+uint64_t startTicks;
+std::chrono::steady_clock::time_point startTime;
+
+} // namespace
+
+void GrammarProfiler::enable() {
+    enabled = true;
+    startTicks = ticks();
+    startTime = std::chrono::steady_clock::now();
+}
+
+int GrammarProfiler::rule(const char* name) {
+    std::lock_guard<std::mutex> lock(rulesMutex);
+    ruleNames.push_back(name);
+    return int(ruleNames.size()) - 1;
+}
+
+RuleStats& GrammarProfiler::stats(int rule) {
+    if (rule >= int(localStats.size())) {
+        std::lock_guard<std::mutex> lock(rulesMutex);
+        size_t i = localStats.size();
+        localStats.resize(ruleNames.size());
+        for (; i < localStats.size(); i++) {
+            localStats[i].name = ruleNames[i];
+        }
+    }
+    return localStats[rule];
+}
+
+void GrammarProfiler::report(FILE* out) {
+    double ns = std::chrono::duration<double, std::nano>(
+                    std::chrono::steady_clock::now() - startTime)
+                    .count();
+    uint64_t elapsed = ticks() - startTicks;
+    double msPerTick = elapsed ? ns / 1e6 / double(elapsed) : 0;
+
+    vector<RuleStats> rows;
+    for (const RuleStats& s : localStats) {
+        if (s.calls) {
+            rows.push_back(s);
+        }
+    }
+    std::sort(rows.begin(), rows.end(),
+              [](const RuleStats& a, const RuleStats& b) {
+                  return a.inclusiveTicks > b.inclusiveTicks;
+              });
+
+    fprintf(out, "%-34s %10s %10s %10s %10s %10s %10s\n", "rule", "calls",
+            "ok", "fail", "rewound", "incl ms", "self ms");
+    for (const RuleStats& s : rows) {
+        fprintf(out, "%-34s %10llu %10llu %10llu %10llu %10.3f %10.3f\n",
+                s.name, (unsigned long long)s.calls,
+                (unsigned long long)s.successes,
+                (unsigned long long)s.failures,
+                (unsigned long long)s.rewound, s.inclusiveTicks * msPerTick,
+                s.selfTicks * msPerTick);
+    }
+}
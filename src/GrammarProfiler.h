@@ -0,0 +1,110 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <x86intrin.h>
+#endif
+
+using std::vector;
+
+class RuleStats {
+public:
+    const char* name = nullptr;
+    uint64_t calls = 0;
+    uint64_t successes = 0;
+    uint64_t failures = 0;
+    // tokens given back by reset() while this rule was the innermost one
+    uint64_t rewound = 0;
+    uint64_t inclusiveTicks = 0;
+    uint64_t selfTicks = 0;
+    // invocations currently on the stack, recursion is only timed once
+    int active = 0;
+};
+
+// Per-rule counters for the parser, filled by PYSER_RULE and Parser::reset
+// in builds with PYSER_PROFILE, once enabled at runtime. Counters belong to
+// the calling thread.
+class GrammarProfiler {
+public:
+    static uint64_t ticks() {
+#if defined(__x86_64__) || defined(_M_X64)
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+#endif
+    }
+
+    static void enable();
+    // Stable id for a rule name, rules look theirs up once.
+    static int rule(const char* name);
+    static RuleStats& stats(int rule);
+    static void rewind(int tokens) {
+        if (enabled && !frames.empty() && tokens > 0) {
+            stats(frames.back().rule).rewound += tokens;
+        }
+    }
+    // Rules sorted by inclusive time, most expensive first.
+    static void report(FILE* out);
+
+public:
+    static inline bool enabled = false;
+
+    struct Frame {
+        int rule;
+        uint64_t start;
+        uint64_t childTicks;
+    };
+    static inline thread_local vector<Frame> frames;
+};
+
+// Times one invocation of a rule. Rules reset to where they started when
+// they give up, so an invocation that leaves without moving the cursor is
+// counted as a failure.
+template <class Cursor> class RuleProfile {
+public:
+    RuleProfile(Cursor& cursor, int rule)
+        : cursor(cursor), rule(rule), on(GrammarProfiler::enabled) {
+        if (!on) {
+            return;
+        }
+        start = cursor.mark();
+        RuleStats& s = GrammarProfiler::stats(rule);
+        s.calls++;
+        s.active++;
+        GrammarProfiler::frames.push_back({rule, GrammarProfiler::ticks(), 0});
+    }
+
+    ~RuleProfile() {
+        if (!on) {
+            return;
+        }
+        GrammarProfiler::Frame f = GrammarProfiler::frames.back();
+        GrammarProfiler::frames.pop_back();
+        uint64_t elapsed = GrammarProfiler::ticks() - f.start;
+        RuleStats& s = GrammarProfiler::stats(rule);
+        if (cursor.mark() > start) {
+            s.successes++;
+        } else {
+            s.failures++;
+        }
+        if (--s.active == 0) {
+            s.inclusiveTicks += elapsed;
+        }
+        s.selfTicks += elapsed - f.childTicks;
+        if (!GrammarProfiler::frames.empty()) {
+            GrammarProfiler::frames.back().childTicks += elapsed;
+        }
+    }
+
+private:
+    Cursor& cursor;
+    int rule;
+    bool on;
+    int start = 0;
+};
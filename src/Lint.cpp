@@ -0,0 +1,182 @@
+#include "Lint.h"
+#include "ParallelWalk.h"
+#include "RecursiveVisitor.h"
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+class Check: public AstPass {
+public:
+    explicit Check(vector<LintFinding>& findings): findings(findings) {}
+
+protected:
+    void report(const ast& node, string message) {
+        findings.push_back({node.span.begin, std::move(message)});
+    }
+
+private:
+    vector<LintFinding>& findings;
+};
+
+// The operands of each comparison of a chain, `a < b < c` being a < b and
+// b < c.
+template <class F> void eachComparison(Compare& node, F&& f) {
+    for (size_t i = 0; i < node.ops.size(); i++) {
+        expr& left = i == 0 ? *node.left : *node.comparators[i - 1];
+        f(left, node.ops[i], *node.comparators[i]);
+    }
+}
+
+class NoneComparison: public Check {
+public:
+    using Check::Check;
+    void enter(ast& node) override {
+        bool found = false;
+        eachComparison(static_cast<Compare&>(node),
+                       [&](expr& left, cmpop op, expr& right) {
+                           found |= (op == cmpop::Eq || op == cmpop::NotEq) &&
+                                    (left.kind == NodeKind::None ||
+                                     right.kind == NodeKind::None);
+                       });
+        if (found) {
+            report(node, "comparison to None, use 'is' or 'is not'");
+        }
+    }
+};
+
+class LiteralIdentity: public Check {
+public:
+    using Check::Check;
+    void enter(ast& node) override {
+        bool found = false;
+        eachComparison(static_cast<Compare&>(node),
+                       [&](expr& left, cmpop op, expr& right) {
+                           found |= (op == cmpop::Is || op == cmpop::IsNot) &&
+                                    (literal(left) || literal(right));
+                       });
+        if (found) {
+            report(node, "'is' with a literal, use '==' or '!='");
+        }
+    }
+
+private:
+    static bool literal(const expr& e) {
+        return e.kind == NodeKind::Num || e.kind == NodeKind::Str;
+    }
+};
+
+class SelfAssignment: public Check {
+public:
+    using Check::Check;
+    void enter(ast& node) override {
+        Assign& a = static_cast<Assign&>(node);
+        if (a.value->kind != NodeKind::Name) {
+            return;
+        }
+        const string& id = static_cast<Name&>(*a.value).id;
+        for (const exprP& target : a.targets) {
+            if (target->kind == NodeKind::Name &&
+                static_cast<Name&>(*target).id == id) {
+                report(node, "'" + id + "' assigned to itself");
+            }
+        }
+    }
+};
+
+// Nesting starts over in every function and class, a block being anything
+// with a body of its own.
+class DeepNesting: public Check {
+public:
+    using Check::Check;
+    void enter(ast& node) override {
+        if (node.kind == NodeKind::FunctionDef ||
+            node.kind == NodeKind::ClassDef) {
+            outer.push_back(depth);
+            depth = 0;
+        } else if (++depth == Linter::maxNesting + 1) {
+            // once per run of too deep blocks, at the first of them
+            report(node, "blocks nested more than " +
+                             std::to_string(Linter::maxNesting) + " deep");
+        }
+    }
+    void leave(ast& node) override {
+        if (node.kind == NodeKind::FunctionDef ||
+            node.kind == NodeKind::ClassDef) {
+            depth = outer.back();
+            outer.pop_back();
+        } else {
+            depth--;
+        }
+    }
+
+private:
+    int depth = 0;
+    vector<int> outer;
+};
+
+} // namespace
+
+Linter::Linter() {
+    auto add = [&](std::unique_ptr<AstPass> check,
+                   std::initializer_list<NodeKind> kinds, bool leave = false) {
+        passes.add(*check, kinds, leave);
+        checks.push_back(std::move(check));
+    };
+    add(std::make_unique<NoneComparison>(findings), {NodeKind::Compare});
+    add(std::make_unique<LiteralIdentity>(findings), {NodeKind::Compare});
+    add(std::make_unique<SelfAssignment>(findings), {NodeKind::Assign});
+    add(std::make_unique<DeepNesting>(findings),
+        {NodeKind::FunctionDef, NodeKind::ClassDef, NodeKind::For,
+         NodeKind::While, NodeKind::If, NodeKind::With, NodeKind::Try},
+        true);
+}
+
+namespace {
+
+// One task of parallelWalk, the Linter behind a pointer for its passes not
+// to move with the visitor.
+class LintWalk: public RecursiveVisitor<LintWalk> {
+public:
+    bool enter(ast& node) {
+        linter->enter(node);
+        return true;
+    }
+    void leave(ast& node) { linter->leave(node); }
+
+public:
+    unique_ptr<Linter> linter = std::make_unique<Linter>();
+};
+
+} // namespace
+
+vector<LintFinding> lint(Module& module, WorkStealingPool* pool) {
+    vector<LintFinding> findings;
+    if (!pool) {
+        Linter linter;
+        linter.run(module);
+        findings = std::move(linter.findings);
+    } else {
+        // the module node itself is no task's
+        Linter top;
+        top.enter(module);
+        findings = parallelWalk(
+            module, *pool, [] { return LintWalk(); }, std::move(findings),
+            [](vector<LintFinding> all, LintWalk walk) {
+                vector<LintFinding>& more = walk.linter->findings;
+                all.insert(all.end(), std::make_move_iterator(more.begin()),
+                           std::make_move_iterator(more.end()));
+                return all;
+            });
+        top.leave(module);
+        findings.insert(findings.end(), top.findings.begin(),
+                        top.findings.end());
+    }
+    // walks go in field order, and parallelWalk takes a definition without
+    // its body first, so neither is source order
+    std::stable_sort(findings.begin(), findings.end(),
+                     [](const LintFinding& a, const LintFinding& b) {
+                         return a.offset < b.offset;
+                     });
+    return findings;
+}
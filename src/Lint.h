@@ -0,0 +1,51 @@
+#pragma once
+
+#include "AST.h"
+#include "PassManager.h"
+#include "WorkStealingPool.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+// A finding of the lint checks, at a byte offset of the source.
+class LintFinding {
+public:
+    uint32_t offset;
+    string message;
+};
+
+// The checks of pyser --lint, each an AstPass, all run by one PassManager
+// in a single walk:
+//   comparison to None with == or !=
+//   'is' or 'is not' with a literal
+//   a name assigned to itself
+//   blocks nested deeper than maxNesting in a function or the module
+// Findings are appended in walk order.
+class Linter {
+public:
+    static constexpr int maxNesting = 5;
+
+    Linter();
+    Linter(const Linter&) = delete;
+    Linter& operator=(const Linter&) = delete;
+
+    void run(ast& root) { passes.run(root); }
+    // one node, for walks done elsewhere
+    void enter(ast& node) { passes.enter(node); }
+    void leave(ast& node) { passes.leave(node); }
+
+public:
+    vector<LintFinding> findings;
+
+private:
+    vector<std::unique_ptr<AstPass>> checks;
+    PassManager passes;
+};
+
+// Every finding in a module, sorted by position. With a pool, the
+// statements and definitions of the module are linted as tasks of their own
+// by parallelWalk.
+vector<LintFinding> lint(Module& module, WorkStealingPool* pool = nullptr);
@@ -1,3 +1,321 @@
 #include "Logger.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using std::atomic;
+using std::shared_ptr;
+using std::string;
+using std::vector;
 
 LogLevel Logger::level = LogLevel::INFO;
+
+namespace {
+
+struct RecordHeader {
+    // whole record, header included, rounded up to the header size so a
+    // wrap marker always fits at the end of a lap
+    uint32_t size;
+    // argument bytes following the header
+    uint32_t args;
+    const char* fmt;
+};
+
+constexpr uint32_t WRAP = UINT32_MAX;
+
+// Single producer, single consumer byte ring. Positions only grow, the
+// producer owns head and the consumer owns tail.
+struct LogBuffer {
+    static constexpr size_t capacity = 1 << 16;
+
+    alignas(16) char data[capacity];
+    atomic<size_t> head{0};
+    atomic<size_t> tail{0};
+    atomic<bool> closed{false};
+    // end of the record between begin() and commit()
+    size_t pending = 0;
+};
+
+struct LocalBuffer {
+    shared_ptr<LogBuffer> buffer;
+    ~LocalBuffer() {
+        if (buffer) {
+            buffer->closed = true;
+        }
+    }
+};
+
+thread_local LocalBuffer local;
+atomic<uint64_t> droppedRecords{0};
+
+template <class T> T read(const char*& p) {
+    T v;
+    memcpy(&v, p, sizeof(v));
+    p += sizeof(v);
+    return v;
+}
+
+// Next argument as an integer, for a '*' width or precision.
+long long readInt(const char*& p, const char* end) {
+    if (p >= end) {
+        return 0;
+    }
+    char tag = *p++;
+    switch (tag) {
+    case LOG_INT:
+        return read<int64_t>(p);
+    case LOG_UINT:
+        return (long long)read<uint64_t>(p);
+    case LOG_DOUBLE:
+        return (long long)read<double>(p);
+    default:
+        p += read<uint32_t>(p) + 1;
+        return 0;
+    }
+}
+
+void appendDigits(string& spec, const char*& f, const char*& p,
+                  const char* end) {
+    if (*f == '*') {
+        f++;
+        spec += std::to_string(readInt(p, end));
+        return;
+    }
+    while (*f >= '0' && *f <= '9') {
+        spec += *f++;
+    }
+}
+
+// printf for a record: the format is walked one conversion at a time and
+// each value is printed according to the type it was logged with.
+void formatRecord(FILE* out, const char* fmt, const char* p,
+                  const char* end) {
+    while (*fmt) {
+        const char* pct = strchr(fmt, '%');
+        if (!pct) {
+            fputs(fmt, out);
+            return;
+        }
+        fwrite(fmt, 1, pct - fmt, out);
+        if (pct[1] == '%') {
+            fputc('%', out);
+            fmt = pct + 2;
+            continue;
+        }
+
+        string spec = "%";
+        const char* f = pct + 1;
+        while (*f && strchr("-+ #0", *f)) {
+            spec += *f++;
+        }
+        appendDigits(spec, f, p, end);
+        if (*f == '.') {
+            spec += *f++;
+            appendDigits(spec, f, p, end);
+        }
+        while (*f && strchr("hljztL", *f)) {
+            f++;
+        }
+        char conv = *f;
+        if (conv) {
+            f++;
+        }
+        fmt = f;
+        if (!conv || p >= end) {
+            fwrite(pct, 1, f - pct, out);
+            continue;
+        }
+
+        switch (*p++) {
+        case LOG_STR: {
+            uint32_t n = read<uint32_t>(p);
+            fprintf(out, (spec + "s").c_str(), p);
+            p += n + 1;
+            break;
+        }
+        case LOG_DOUBLE: {
+            double d = read<double>(p);
+            spec += strchr("fFeEgGaA", conv) ? conv : 'g';
+            fprintf(out, spec.c_str(), d);
+            break;
+        }
+        case LOG_INT: {
+            long long i = read<int64_t>(p);
+            if (conv == 'c') {
+                fprintf(out, (spec + "c").c_str(), int(i));
+            } else {
+                spec += "ll";
+                spec += strchr("diouxX", conv) ? conv : 'd';
+                fprintf(out, spec.c_str(), i);
+            }
+            break;
+        }
+        case LOG_UINT: {
+            unsigned long long u = read<uint64_t>(p);
+            if (conv == 'p') {
+                fprintf(out, (spec + "p").c_str(), (void*)uintptr_t(u));
+            } else if (conv == 'c') {
+                fprintf(out, (spec + "c").c_str(), int(u));
+            } else {
+                spec += "ll";
+                spec += strchr("diouxX", conv) ? conv : 'u';
+                fprintf(out, spec.c_str(), u);
+            }
+            break;
+        }
+        default:
+            p = end;
+            break;
+        }
+    }
+}
+
+class Drainer {
+public:
+    ~Drainer() {
+        if (thread.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(wakeMutex);
+                stopping = true;
+            }
+            wake.notify_one();
+            thread.join();
+        }
+        drain();
+    }
+
+    void add(shared_ptr<LogBuffer> buffer) {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        buffers.push_back(move(buffer));
+        if (!thread.joinable()) {
+            thread = std::thread([this] { run(); });
+        }
+    }
+
+    // Consumes every buffer. Only one caller drains at a time, which keeps
+    // each buffer single-consumer.
+    void drain() {
+        std::lock_guard<std::mutex> drainLock(drainMutex);
+        vector<shared_ptr<LogBuffer>> current;
+        {
+            std::lock_guard<std::mutex> lock(buffersMutex);
+            current = buffers;
+        }
+        for (const shared_ptr<LogBuffer>& b : current) {
+            drain(*b);
+        }
+        fflush(sink.load());
+
+        // buffers of exited threads go once they are empty
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        for (size_t i = 0; i < buffers.size();) {
+            LogBuffer& b = *buffers[i];
+            if (b.closed && b.tail.load() == b.head.load()) {
+                buffers[i] = move(buffers.back());
+                buffers.pop_back();
+            } else {
+                i++;
+            }
+        }
+    }
+
+public:
+    atomic<FILE*> sink{stderr};
+
+private:
+    void drain(LogBuffer& b) {
+        size_t t = b.tail.load(std::memory_order_relaxed);
+        size_t h = b.head.load(std::memory_order_acquire);
+        while (t < h) {
+            size_t off = t % LogBuffer::capacity;
+            RecordHeader header;
+            memcpy(&header, b.data + off, sizeof(header));
+            if (header.size == WRAP) {
+                t += LogBuffer::capacity - off;
+                continue;
+            }
+            const char* args = b.data + off + sizeof(header);
+            formatRecord(sink.load(), header.fmt, args, args + header.args);
+            t += header.size;
+        }
+        b.tail.store(t, std::memory_order_release);
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        while (!stopping) {
+            lock.unlock();
+            drain();
+            lock.lock();
+            wake.wait_for(lock, std::chrono::milliseconds(1));
+        }
+    }
+
+private:
+    std::mutex buffersMutex;
+    vector<shared_ptr<LogBuffer>> buffers;
+    std::mutex drainMutex;
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::thread thread;
+};
+
+Drainer& drainer() {
+    static Drainer d;
+    return d;
+}
+
+} // namespace
+
+char* Logger::begin(const char* fmt, size_t size) {
+    LogBuffer* b = local.buffer.get();
+    if (!b) {
+        local.buffer = std::make_shared<LogBuffer>();
+        b = local.buffer.get();
+        drainer().add(local.buffer);
+    }
+
+    constexpr size_t align = sizeof(RecordHeader);
+    size_t total = (sizeof(RecordHeader) + size + align - 1) & ~(align - 1);
+    size_t h = b->head.load(std::memory_order_relaxed);
+    size_t t = b->tail.load(std::memory_order_acquire);
+    size_t off = h % LogBuffer::capacity;
+    size_t contiguous = LogBuffer::capacity - off;
+    // a record never wraps, the rest of the lap is skipped instead
+    size_t need = total <= contiguous ? total : contiguous + total;
+    if (total > LogBuffer::capacity / 2 ||
+        LogBuffer::capacity - (h - t) < need) {
+        droppedRecords++;
+        return nullptr;
+    }
+    if (total > contiguous) {
+        RecordHeader wrap{WRAP, 0, nullptr};
+        memcpy(b->data + off, &wrap, sizeof(wrap));
+        h += contiguous;
+        off = 0;
+    }
+
+    RecordHeader header{uint32_t(total), uint32_t(size), fmt};
+    memcpy(b->data + off, &header, sizeof(header));
+    b->pending = h + total;
+    return b->data + off + sizeof(header);
+}
+
+void Logger::commit() {
+    LogBuffer* b = local.buffer.get();
+    b->head.store(b->pending, std::memory_order_release);
+}
+
+void Logger::setSink(FILE* sink) {
+    flush();
+    drainer().sink.store(sink);
+}
+
+void Logger::flush() { drainer().drain(); }
+
+uint64_t Logger::dropped() { return droppedRecords; }
@@ -1,34 +1,125 @@
 #pragma once
-#include <cstdarg>
+#include <cstdint>
 #include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
 
 enum class LogLevel {
     DEBUG,
     INFO,
 };
 
+// type tags of the arguments stored in a log record
+enum LogArgTag : char {
+    LOG_INT = 'i',
+    LOG_UINT = 'u',
+    LOG_DOUBLE = 'd',
+    LOG_STR = 's',
+};
+
+// Logging only copies the format pointer and the raw arguments into a ring
+// buffer owned by the calling thread, without locks. A background thread
+// formats the records printf-style and writes them to the sink, so logging
+// neither blocks nor shares the stdout stream the AST is printed on. When a
+// thread's buffer is full, records are dropped and counted instead.
+//
+// Supported arguments are integers, floating point numbers, pointers and
+// strings; strings are copied, so temporaries like
+// `t.toString().c_str()` are fine. The format string itself must outlive
+// the program, which is what string literals do.
 class Logger {
 public:
-    static void debug(const char* fmt, ...) {
+    template <class... Args> static void debug(const char* fmt, Args... args) {
         if (level > LogLevel::DEBUG) {
             return;
         }
-        va_list args;
-        va_start(args, fmt);
-        vfprintf(stdout, fmt, args);
-        va_end(args);
+        log(fmt, args...);
     }
 
-    static void info(const char* fmt, ...) {
+    template <class... Args> static void info(const char* fmt, Args... args) {
         if (level > LogLevel::INFO) {
             return;
         }
-        va_list args;
-        va_start(args, fmt);
-        vfprintf(stdout, fmt, args);
-        va_end(args);
+        log(fmt, args...);
     }
 
+    // stderr by default
+    static void setSink(FILE* sink);
+    // Writes out everything logged so far by any thread.
+    static void flush();
+    static uint64_t dropped();
+
 public:
     static LogLevel level;
+
+private:
+    template <class... Args> static void log(const char* fmt, Args... args) {
+        size_t size = (argSize(args) + ... + 0);
+        char* p = begin(fmt, size);
+        if (!p) {
+            return;
+        }
+        (encode(p, args), ...);
+        commit();
+    }
+
+    static const char* str(const char* s) { return s ? s : "(null)"; }
+
+    template <class T> static size_t argSize(const T& v) {
+        if constexpr (std::is_same_v<T, std::string>) {
+            return 1 + sizeof(uint32_t) + v.size() + 1;
+        } else if constexpr (std::is_convertible_v<T, const char*>) {
+            return 1 + sizeof(uint32_t) + strlen(str(v)) + 1;
+        } else {
+            static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T> ||
+                              std::is_pointer_v<T>,
+                          "unsupported log argument");
+            return 1 + sizeof(uint64_t);
+        }
+    }
+
+    static void encodeStr(char*& p, const char* s, uint32_t n) {
+        *p++ = LOG_STR;
+        memcpy(p, &n, sizeof(n));
+        p += sizeof(n);
+        memcpy(p, s, n);
+        p[n] = '\0';
+        p += n + 1;
+    }
+
+    template <class T> static void encode(char*& p, const T& v) {
+        if constexpr (std::is_same_v<T, std::string>) {
+            encodeStr(p, v.data(), uint32_t(v.size()));
+        } else if constexpr (std::is_convertible_v<T, const char*>) {
+            const char* s = str(v);
+            encodeStr(p, s, uint32_t(strlen(s)));
+        } else if constexpr (std::is_floating_point_v<T>) {
+            double d = v;
+            *p++ = LOG_DOUBLE;
+            memcpy(p, &d, sizeof(d));
+            p += sizeof(d);
+        } else if constexpr (std::is_pointer_v<T>) {
+            uint64_t u = uint64_t(uintptr_t(v));
+            *p++ = LOG_UINT;
+            memcpy(p, &u, sizeof(u));
+            p += sizeof(u);
+        } else if constexpr (std::is_enum_v<T> || std::is_signed_v<T>) {
+            int64_t i = int64_t(v);
+            *p++ = LOG_INT;
+            memcpy(p, &i, sizeof(i));
+            p += sizeof(i);
+        } else {
+            uint64_t u = uint64_t(v);
+            *p++ = LOG_UINT;
+            memcpy(p, &u, sizeof(u));
+            p += sizeof(u);
+        }
+    }
+
+    // Reserves a record of `size` argument bytes in this thread's buffer,
+    // or returns nullptr if it is full.
+    static char* begin(const char* fmt, size_t size);
+    // Publishes the record reserved by begin().
+    static void commit();
 };
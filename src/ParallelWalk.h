@@ -0,0 +1,52 @@
+#pragma once
+
+#include "AST.h"
+#include "WorkStealingPool.h"
+#include <optional>
+#include <utility>
+
+// Independent subtrees of a module: its statements, and in turn those of the
+// bodies of function and class definitions.
+inline void splitSubtrees(stmtPs& body, vector<stmt*>& subtrees) {
+    for (stmtP& s : body) {
+        subtrees.push_back(s.get());
+        if (s->kind == NodeKind::FunctionDef) {
+            splitSubtrees(static_cast<FunctionDef&>(*s).body, subtrees);
+        } else if (s->kind == NodeKind::ClassDef) {
+            splitSubtrees(static_cast<ClassDef&>(*s).body, subtrees);
+        }
+    }
+}
+
+// Walks a module with one visitor per subtree, the subtrees spread over a
+// WorkStealingPool. makeVisitor() builds a RecursiveVisitor for every task;
+// the visitors are then folded into `result` by reduce(result, visitor) in
+// source order, on the calling thread. A task for a function or class
+// definition walks it without its body, the statements of the body being
+// tasks of their own. The tree is only read.
+template <class Result, class MakeVisitor, class Reduce>
+Result parallelWalk(Module& module, WorkStealingPool& pool,
+                    MakeVisitor makeVisitor, Result result, Reduce reduce) {
+    using V = decltype(makeVisitor());
+    vector<stmt*> subtrees;
+    splitSubtrees(module.body, subtrees);
+    vector<std::optional<V>> visitors(subtrees.size());
+
+    pool.run(subtrees.size(), [&](size_t i) {
+        V visitor = makeVisitor();
+        stmt& s = *subtrees[i];
+        if (s.kind == NodeKind::FunctionDef) {
+            visitor.walkWithout(s, static_cast<FunctionDef&>(s).body);
+        } else if (s.kind == NodeKind::ClassDef) {
+            visitor.walkWithout(s, static_cast<ClassDef&>(s).body);
+        } else {
+            visitor.walk(s);
+        }
+        visitors[i].emplace(std::move(visitor));
+    });
+
+    for (std::optional<V>& visitor : visitors) {
+        result = reduce(std::move(result), std::move(*visitor));
+    }
+    return result;
+}
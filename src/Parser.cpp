@@ -1,5 +1,6 @@
 #include "Parser.h"
-#include "Logger.h"
+#include "Trace.h"
+#include <algorithm>
 #include <memory>
 #include <iostream>
 
@@ -17,50 +18,236 @@ unordered_set<string> Parser::keywords = {"and", "or",    "not",    "is",
                                           "as",  "from",  "pass"};
 
 unique_ptr<Module> Parser::file() {
-    int p = mark();
-    optional<stmtPs> stmts = statements();
-    if (stmts) {
+    stmtPs body;
+    while (true) {
+        if (optional<stmtPs> stmts = statements()) {
+            for (size_t i = 0; i < stmts->size(); i++) {
+                body.push_back(move(stmts->operator[](i)));
+            }
+        }
         while (expect(Token::Type::NEWLINE))
             ;
-        if (!expect(Token::Type::ENDMARKER)) {
-            Logger::debug("expect ENDMARKER, but got %s\n",
-                          peek().toString().c_str());
-            goto parse_error;
+        if (expect(Token::Type::ENDMARKER)) {
+            break;
         }
-        return std::make_unique<Module>(move(*stmts));
+        // statements() only stops early at a DEDENT it has no block for
+        PYSER_DEBUG("expect ENDMARKER, but got %s\n",
+                    peek().toString().c_str());
+        error("IndentationError: unexpected unindent", mark());
+        next();
     }
-parse_error:
-    throw std::runtime_error("SyntaxError: invalid syntax");
-    reset(p);
-    return nullptr;
+    auto module = spanned(0, make_unique<Module>(move(body)));
+    // the module covers the whole input, blank lines and comments included
+    module->span = {0, uint32_t(tokenAt(mark() - 1).offset)};
+    return module;
 }
 
 // statements: statement+
+//
+// A statement that fails to parse is reported and skipped up to the next
+// NEWLINE, so a single pass reports every broken statement of the block.
 optional<stmtPs> Parser::statements() {
-    Logger::debug("statements\n");
+    PYSER_RULE("statements");
     int p = mark();
+    size_t errors = diagnostics.size();
+    // the statement just skipped ended with a colon, so may own a block
+    bool skippedHeader = false;
 
     stmtPs stmts;
-    if (optional<stmtPs> xs = statement()) {
-        for (size_t i = 0; i < xs->size(); i++) {
-            stmts.push_back(move(xs->operator[](i)));
-        }
-
-        while (optional<stmtPs> xs = statement()) {
+    while (true) {
+        int p1 = mark();
+        size_t n = diagnostics.size();
+        farthest = -1;
+        if (optional<stmtPs> xs = statement()) {
             for (size_t i = 0; i < xs->size(); i++) {
                 stmts.push_back(move(xs->operator[](i)));
             }
+            skippedHeader = false;
+            continue;
         }
-        return stmts;
+        reset(p1);
+        if (lookahead(Token::Type::DEDENT) ||
+            lookahead(Token::Type::ENDMARKER)) {
+            break;
+        }
+        if (expect(Token::Type::NEWLINE)) {
+            continue;
+        }
+        if (lookahead(Token::Type::INDENT)) {
+            // the block of a statement that has just been skipped is still
+            // parsed for its own errors, then dropped
+            if (!skippedHeader) {
+                error("IndentationError: unexpected indent", mark());
+            }
+            skippedHeader = false;
+            next();
+            statements();
+            expect(Token::Type::DEDENT);
+            continue;
+        }
+        if (diagnostics.size() == n) {
+            syntaxError();
+        }
+        skippedHeader = synchronize();
     }
 
-    reset(p);
-    return nullopt;
+    if (stmts.empty() && diagnostics.size() == errors) {
+        reset(p);
+        return nullopt;
+    }
+    return stmts;
+}
+
+// Skips the rest of a broken statement, up to and including the next
+// NEWLINE outside brackets. Stops early at DEDENT or ENDMARKER. Returns
+// whether the statement ended with a colon, like the header of a block.
+bool Parser::synchronize() {
+    int depth = 0;
+    bool colon = false;
+    while (true) {
+        Token::Type type = peek().type;
+        switch (type) {
+        case Token::Type::ENDMARKER:
+        case Token::Type::DEDENT:
+            return false;
+        case Token::Type::LPAR:
+        case Token::Type::LSQB:
+        case Token::Type::LBRACE:
+            depth++;
+            break;
+        case Token::Type::RPAR:
+        case Token::Type::RSQB:
+        case Token::Type::RBRACE:
+            if (depth > 0) {
+                depth--;
+            }
+            break;
+        case Token::Type::NEWLINE:
+            if (depth == 0) {
+                next();
+                return colon;
+            }
+            break;
+        default:
+            break;
+        }
+        colon = type == Token::Type::COLON;
+        next();
+    }
+}
+
+// Reports the farthest point the rules tried so far got to, together with
+// every token that would have let them go on.
+void Parser::syntaxError() {
+    int p = farthest >= 0 ? farthest : mark();
+    vector<string> want;
+    for (size_t i = 0; i < expectedKeywords.size(); i++) {
+        if (expectedKeywords[i]) {
+            want.push_back(string("'") + keywordNames[i] + "'");
+        }
+    }
+    for (size_t i = 0; i < expectedTypes.size(); i++) {
+        if (expectedTypes[i]) {
+            want.push_back(Token::typeToString(Token::Type(i)));
+        }
+    }
+
+    const Token& t = tokenAt(p);
+    // the tokenizer leaves the opening quotes of a literal nothing closes
+    if (t.type == Token::Type::ERRORTOKEN && t.raw.size() &&
+        (t.raw[0] == '\'' || t.raw[0] == '"')) {
+        error(t.raw.size() == 3
+                  ? "SyntaxError: unterminated triple-quoted string literal"
+                  : "SyntaxError: unterminated string literal",
+              p);
+        return;
+    }
+    string got = Token::typeToString(t.type);
+    if (!t.raw.empty()) {
+        got += " '" + t.raw + "'";
+    }
+
+    if (want.empty()) {
+        error("SyntaxError: invalid syntax, got " + got, p);
+        return;
+    }
+    string message = "SyntaxError: expected ";
+    for (size_t i = 0; i < want.size(); i++) {
+        if (i > 0) {
+            message += i + 1 == want.size() ? " or " : ", ";
+        }
+        message += want[i];
+    }
+    error(message + ", got " + got, p);
+}
+
+void Parser::error(const string& message, int p) {
+    // alternatives that run into the same broken token report it once
+    for (const Diagnostic& d : diagnostics) {
+        if (d.token == p) {
+            return;
+        }
+    }
+    const Token& t = tokenAt(p);
+    diagnostics.push_back(Diagnostic(message, p, t.line, t.col));
+}
+
+bool Parser::stop(ParseLimit limit) {
+    static const char* const messages[] = {
+        "", "ParseLimitError: deadline exceeded",
+        "ParseLimitError: step limit exceeded",
+        "ParseLimitError: nesting depth limit exceeded"};
+    limitHit = limit;
+    int p = mark();
+    const Token& t = tokenAt(p);
+    // not deduplicated like other errors, it has to be told apart
+    diagnostics.push_back(Diagnostic(messages[int(limit)], p, t.line, t.col));
+    tokenizer.reset(int(tokenizer.tokens.size()));
+    return false;
+}
+
+const Token& Parser::tokenAt(int p) {
+    static const Token end(Token::Type::ENDMARKER);
+    const vector<Token>& tokens = tokenizer.tokens;
+    if (p < int(tokens.size())) {
+        return tokens[p];
+    }
+    return tokens.empty() ? end : tokens.back();
+}
+
+void Parser::finishNode(ast& node, int first) {
+    setSpan(node, first);
+    hashNode(node);
+}
+
+// Layout tokens at the end of a statement or block are not part of its
+// span.
+void Parser::setSpan(ast& node, int first) {
+    int last = mark() - 1;
+    while (last > first) {
+        Token::Type type = tokenAt(last).type;
+        if (type != Token::Type::NEWLINE && type != Token::Type::INDENT &&
+            type != Token::Type::DEDENT && type != Token::Type::ENDMARKER) {
+            break;
+        }
+        last--;
+    }
+    const Token& t = tokenAt(first);
+    node.span.begin = uint32_t(t.offset);
+    node.span.end = node.span.begin;
+    if (last >= first) {
+        const Token& u = tokenAt(last);
+        node.span.end = uint32_t(u.offset + u.raw.size());
+    }
+}
+
+void Parser::hashNode(ast& node) {
+    node.hash = structuralHash(node, hashIdentifiers);
 }
 
 // statement: compound_stmt  | simple_stmts
 optional<stmtPs> Parser::statement() {
-    Logger::debug("statement\n");
+    PYSER_RULE("statement");
     int p = mark();
 
     if (stmtP s = compound_stmt()) {
@@ -84,13 +271,13 @@ block:
         | simple_stmts
 */
 optional<stmtPs> Parser::block() {
-    Logger::debug("block\n");
+    PYSER_RULE("block");
     int p = mark();
     optional<stmtPs> stmts;
 
     if (expect(Token::Type::NEWLINE)) {
         if (!expect(Token::Type::INDENT)) {
-            Logger::debug("expect indent after newline in block\n");
+            PYSER_DEBUG("expect indent after newline in block\n");
             reset(p);
             return nullopt;
         }
@@ -116,7 +303,7 @@ optional<stmtPs> Parser::block() {
 }
 
 stmtP Parser::compound_stmt() {
-    Logger::debug("compound stmt\n");
+    PYSER_RULE("compound_stmt");
     int p = mark();
     stmtP stmt;
     if ((stmt = function_def())) {
@@ -157,7 +344,7 @@ stmtP Parser::compound_stmt() {
 stmtP Parser::function_def() { return nullptr; }
 
 stmtP Parser::if_stmt() {
-    Logger::debug("if stmt\n");
+    PYSER_RULE("if_stmt");
     return nullptr;
 }
 
@@ -171,19 +358,20 @@ while_stmt:
         | 'while' named_expression ':' block [else_block]
 */
 stmtP Parser::while_stmt() {
-    Logger::debug("while stmt\n");
+    PYSER_RULE("while_stmt");
     int p = mark();
-    if (expect("while")) {
+    if (expect(Keyword::While)) {
         exprP test = named_expression();
         if (expect(Token::Type::COLON)) {
             optional<stmtPs> body = block();
             stmtPs orelse;
             if (body) {
-                Logger::debug("parse while succ\n");
-                return make_unique<While>(move(test), move(*body),
-                                          move(orelse));
+                PYSER_DEBUG("parse while succ\n");
+                return spanned(
+                    p, make_unique<While>(move(test), move(*body),
+                                          move(orelse)));
             }
-            Logger::debug("parse while fail\n");
+            PYSER_DEBUG("parse while fail\n");
         }
     }
     reset(p);
@@ -196,7 +384,7 @@ stmtP Parser::match_stmt() { return nullptr; }
 //	   | simple_stmt !';' NEWLINE  # Not needed, there for speedup
 //	   | ';'.simple_stmt+ [';'] NEWLINE
 optional<stmtPs> Parser::simple_stmts() {
-    Logger::debug("simple stmts\n");
+    PYSER_RULE("simple_stmts");
     int p = mark();
 
     stmtPs stmts;
@@ -216,8 +404,8 @@ optional<stmtPs> Parser::simple_stmts() {
         }
         while (expect(Token::Type::NEWLINE))
             ;
-        Logger::debug("simple stmts succ, next: %s\n",
-                      peek().toString().c_str());
+        PYSER_DEBUG("simple stmts succ, next: %s\n",
+                    peek().toString().c_str());
         return stmts;
     }
 
@@ -226,6 +414,7 @@ optional<stmtPs> Parser::simple_stmts() {
 }
 
 stmtP Parser::simple_stmt() {
+    PYSER_RULE("simple_stmt");
     int p = mark();
 
     stmtP stmt;
@@ -234,7 +423,7 @@ stmtP Parser::simple_stmt() {
     }
     reset(p);
     if (exprP e = star_expressions()) {
-        return make_unique<Expr>(move(e));
+        return spanned(p, make_unique<Expr>(move(e)));
     }
     reset(p);
     if ((stmt = return_stmt())) {
@@ -293,12 +482,12 @@ stmtP Parser::simple_stmt() {
 //	   [TYPE_COMMENT] | single_target augassign ~ (yield_expr |
 //	   star_expressions)
 stmtP Parser::assignment() {
-    Logger::debug("assignment\n");
+    PYSER_RULE("assignment");
     int p = mark();
     exprP lhs;
     // case 1:
     //     NAME ':' expression ['=' annotated_rhs ]
-    Logger::debug("assignment case 1\n");
+    PYSER_DEBUG("assignment case 1\n");
     unique_ptr<Name> name;
     if ((name = expectN()) && expect(Token::Type::COLON)) {
         name->set_expr_context(expr_context::Store);
@@ -306,11 +495,13 @@ stmtP Parser::assignment() {
             int p2 = mark();
             exprP value;
             if (expect(Token::Type::EQUAL) && (value = annotated_rhs())) {
-                return make_unique<AnnAssign>(move(name), move(anno),
-                                              move(value), 1);
+                return spanned(
+                    p, make_unique<AnnAssign>(move(name), move(anno),
+                                              move(value), 1));
             }
             reset(p2);
-            return make_unique<AnnAssign>(move(name), nullptr, move(value), 1);
+            return spanned(
+                p, make_unique<AnnAssign>(move(name), nullptr, move(value), 1));
         }
     }
     reset(p);
@@ -321,7 +512,7 @@ stmtP Parser::assignment() {
     //	   =>
     //	   '(' single_target ')' ':' expression ['=' annotated_rhs ]
     //	   single_subscript_attribute_target ':' expression ['=' annotated_rhs ]
-    Logger::debug("assignment case 2\n");
+    PYSER_DEBUG("assignment case 2\n");
     if (expect(Token::Type::LPAR) && (lhs = single_target()) &&
         expect(Token::Type::RPAR)) {
         lhs->set_expr_context(expr_context::Store);
@@ -330,12 +521,14 @@ stmtP Parser::assignment() {
                 int p2 = mark();
                 exprP rhs;
                 if (expect(Token::Type::EQUAL) && (rhs = annotated_rhs())) {
-                    return make_unique<AnnAssign>(move(lhs), move(anno),
-                                                  move(rhs), 0);
+                    return spanned(
+                        p, make_unique<AnnAssign>(move(lhs), move(anno),
+                                                  move(rhs), 0));
                 }
                 reset(p2);
-                return make_unique<AnnAssign>(move(lhs), move(anno), nullptr,
-                                              0);
+                return spanned(
+                    p, make_unique<AnnAssign>(move(lhs), move(anno), nullptr,
+                                              0));
             }
         }
     }
@@ -347,12 +540,14 @@ stmtP Parser::assignment() {
                 int p2 = mark();
                 exprP rhs;
                 if (expect(Token::Type::EQUAL) && (rhs = annotated_rhs())) {
-                    return make_unique<AnnAssign>(move(lhs), move(anno),
-                                                  move(rhs), 0);
+                    return spanned(
+                        p, make_unique<AnnAssign>(move(lhs), move(anno),
+                                                  move(rhs), 0));
                 }
                 reset(p2);
-                return make_unique<AnnAssign>(move(lhs), move(anno), nullptr,
-                                              0);
+                return spanned(
+                    p, make_unique<AnnAssign>(move(lhs), move(anno), nullptr,
+                                              0));
             }
         }
     }
@@ -360,7 +555,7 @@ stmtP Parser::assignment() {
     // case 3:
     //     (star_targets '=' )+ (yield_expr | star_expressions) !'='
     //     [TYPE_COMMENT]
-    Logger::debug("assignment case 3\n");
+    PYSER_DEBUG("assignment case 3\n");
     reset(p);
     exprPs ts;
     exprP t;
@@ -378,13 +573,13 @@ stmtP Parser::assignment() {
         exprP rhs;
         if ((p1 = mark()) && (rhs = yield_expr()) &&
             !lookahead(Token::Type::EQUAL)) {
-            return make_unique<Assign>(move(ts), move(rhs));
+            return spanned(p, make_unique<Assign>(move(ts), move(rhs)));
         }
         reset(p1);
         int p0 = mark();
         if ((p0 = mark()) && (rhs = star_expressions()) &&
             !lookahead(Token::Type::EQUAL)) {
-            return make_unique<Assign>(move(ts), move(rhs));
+            return spanned(p, make_unique<Assign>(move(ts), move(rhs)));
         }
         reset(p0);
     }
@@ -392,17 +587,19 @@ stmtP Parser::assignment() {
     // case 4:
     //	   single_target augassign ~ (yield_expr | star_expressions)
     reset(p);
-    Logger::debug("assignment case 4\n");
+    PYSER_DEBUG("assignment case 4\n");
     if (exprP t = single_target()) {
         t->set_expr_context(expr_context::Store);
         if (optional<operator_> op = augassign()) {
             int p1 = mark();
             if (exprP rhs = yield_expr()) {
-                return make_unique<AugAssign>(move(t), *op, move(rhs));
+                return spanned(
+                    p, make_unique<AugAssign>(move(t), *op, move(rhs)));
             }
             reset(p1);
             if (exprP rhs = star_expressions()) {
-                return make_unique<AugAssign>(move(t), *op, move(rhs));
+                return spanned(
+                    p, make_unique<AugAssign>(move(t), *op, move(rhs)));
             }
         }
     }
@@ -413,6 +610,7 @@ stmtP Parser::assignment() {
 
 // annotated_rhs: yield_expr | star_expressions
 exprP Parser::annotated_rhs() {
+    PYSER_RULE("annotated_rhs");
     int p = mark();
     if (exprP e = yield_expr()) {
         return e;
@@ -430,6 +628,7 @@ exprP Parser::annotated_rhs() {
 //	   | NAME
 //	   | '(' single_target ')'
 exprP Parser::single_target() {
+    PYSER_RULE("single_target");
     int p = mark();
     if (exprP e = single_subscript_attribute_target()) {
         return e;
@@ -455,12 +654,10 @@ exprP Parser::single_target() {
 //	   | t_primary '.' NAME !t_lookahead
 //	   | t_primary '[' slices ']' !t_lookahead
 exprP Parser::single_subscript_attribute_target() {
+    PYSER_RULE("single_subscript_attribute_target");
     int p = mark();
     if (exprP t = t_primary()) {
-        expr* target = t.get();
-        if (Attribute* attr = dynamic_cast<Attribute*>(target)) {
-            return t;
-        } else if (Subscript* sub = dynamic_cast<Subscript*>(target)) {
+        if (t->kind == NodeKind::Attribute || t->kind == NodeKind::Subscript) {
             return t;
         }
     }
@@ -469,6 +666,7 @@ exprP Parser::single_subscript_attribute_target() {
 }
 
 exprP Parser::t_primary() {
+    PYSER_RULE("t_primary");
     int p = mark();
     static const Token& t = Token(Token::Type::DOT, ".");
     optional<BindingPower> bp = infix_binding_power(t);
@@ -483,16 +681,17 @@ exprP Parser::t_primary() {
 //	   | 'yield' 'from' expression
 //	   | 'yield' [star_expressions]
 exprP Parser::yield_expr() {
+    PYSER_RULE("yield_expr");
     int p = mark();
-    if (expect("yield") && expect("from")) {
+    if (expect(Keyword::Yield) && expect(Keyword::From)) {
         if (exprP e = expression()) {
-            return make_unique<YieldFrom>(move(e));
+            return spanned(p, make_unique<YieldFrom>(move(e)));
         }
     }
     reset(p);
-    if (expect("yield")) {
+    if (expect(Keyword::Yield)) {
         exprP e = star_expressions();
-        return make_unique<Yield>(move(e));
+        return spanned(p, make_unique<Yield>(move(e)));
     }
     reset(p);
     return nullptr;
@@ -513,6 +712,7 @@ exprP Parser::yield_expr() {
 //	   | '**='
 //	   | '//='
 optional<operator_> Parser::augassign() {
+    PYSER_RULE("augassign");
     int p = mark();
     const Token& t = peek();
     optional<operator_> op = nullopt;
@@ -572,6 +772,7 @@ optional<operator_> Parser::augassign() {
 //	   | star_expression ','
 //	   | star_expression
 exprP Parser::star_expressions() {
+    PYSER_RULE("star_expressions");
     int p = mark();
     exprPs elts;
     if (exprP e = star_expression()) {
@@ -584,7 +785,8 @@ exprP Parser::star_expressions() {
         reset(p1);
         expect(Token::Type::COMMA);
         if (elts.size() > 1) {
-            return make_unique<Tuple>(move(elts), expr_context::Load);
+            return spanned(
+                p, make_unique<Tuple>(move(elts), expr_context::Load));
         }
         return move(elts[0]);
     }
@@ -596,11 +798,13 @@ exprP Parser::star_expressions() {
 //	   | '*' bitwise_or
 //	   | expression
 exprP Parser::star_expression() {
+    PYSER_RULE("star_expression");
     int p = mark();
     if (expect(Token::Type::STAR)) {
         exprP e = bitwise_or();
         if (e) {
-            return make_unique<Starred>(move(e), expr_context::Load);
+            return spanned(
+                p, make_unique<Starred>(move(e), expr_context::Load));
         }
     }
     reset(p);
@@ -617,6 +821,7 @@ exprP Parser::expression() {
 }
 
 exprP Parser::bitwise_or() {
+    PYSER_RULE("bitwise_or");
     int p = mark();
     static const Token& t = Token(Token::Type::VBAR, "|");
     optional<BindingPower> bp = infix_binding_power(t);
@@ -628,6 +833,7 @@ exprP Parser::bitwise_or() {
 }
 
 exprPs Parser::star_named_expressions() {
+    PYSER_RULE("star_named_expressions");
     int p = mark();
     exprPs elts;
     if (exprP e = star_named_expression()) {
@@ -646,11 +852,13 @@ exprPs Parser::star_named_expressions() {
 }
 
 exprP Parser::star_named_expression() {
+    PYSER_RULE("star_named_expression");
     int p = mark();
     if (expect(Token::Type::STAR)) {
         exprP e = bitwise_or();
         if (e) {
-            return make_unique<Starred>(move(e), expr_context::Load);
+            return spanned(
+                p, make_unique<Starred>(move(e), expr_context::Load));
         }
     }
     reset(p);
@@ -662,6 +870,7 @@ exprP Parser::star_named_expression() {
 }
 
 exprP Parser::named_expression() {
+    PYSER_RULE("named_expression");
     int p = mark();
     exprP e;
     if ((e = assignment_expression())) {
@@ -676,11 +885,14 @@ exprP Parser::named_expression() {
 }
 
 exprP Parser::assignment_expression() {
+    PYSER_RULE("assignment_expression");
     int p = mark();
     exprP target;
     exprP value;
-    if ((target = expectN()) && (value = expression())) {
-        return make_unique<NamedExpr>(move(target), move(value));
+    if ((target = expectN()) && expect(Token::Type::COLONEQUAL) &&
+        (value = expression())) {
+        target->set_expr_context(expr_context::Store);
+        return spanned(p, make_unique<NamedExpr>(move(target), move(value)));
     }
     reset(p);
     return nullptr;
@@ -689,9 +901,10 @@ exprP Parser::assignment_expression() {
 stmtP Parser::return_stmt() { return nullptr; }
 
 stmtP Parser::import_stmt() {
+    PYSER_RULE("import_stmt");
     auto p = mark();
     if (auto alias = import_name()) {
-        return make_unique<Import>(move(*alias));
+        return spanned(p, make_unique<Import>(move(*alias)));
     }
     if (auto import_from_stmt = import_from()) {
         return import_from_stmt;
@@ -701,8 +914,9 @@ stmtP Parser::import_stmt() {
 }
 
 optional<std::vector<alias>> Parser::import_name() {
+    PYSER_RULE("import_name");
     auto p = mark();
-    if (expect("import")) {
+    if (expect(Keyword::Import)) {
         if (auto alias = dotted_as_names()) {
             return alias;
         }
@@ -712,6 +926,7 @@ optional<std::vector<alias>> Parser::import_name() {
 }
 
 optional<string> Parser::dotted_name() {
+    PYSER_RULE("dotted_name");
     // dotted_name := dotted_name . NAME | Name
     // which is equavalent with
     // dotted_name := NAME dotted_name_1
@@ -731,19 +946,20 @@ optional<string> Parser::dotted_name() {
             reset(p);
             return nullopt;
         }
-    } while (expect("."));
+    } while (expect(Token::Type::DOT));
     dot_name.pop_back();
     return dot_name;
 }
 
 optional<vector<alias>> Parser::dotted_as_names() {
+    PYSER_RULE("dotted_as_names");
     auto p = mark();
     vector<alias> aliases;
     auto dotted_as_name = [this]() -> optional<alias> {
         // dotted_as_name := dotted_name ['as' NAME]
         auto p = mark();
         if (auto dn = dotted_name()) {
-            if (expect("as")) {
+            if (expect(Keyword::As)) {
                 if (auto name = expectN()) {
                     return alias(*dn, name->id);
                 }
@@ -767,6 +983,7 @@ optional<vector<alias>> Parser::dotted_as_names() {
 }
 
 stmtP Parser::import_from() {
+    PYSER_RULE("import_from");
     // import_from:
     //     | 'from' ('.' | '...')* dotted_name 'import' import_from_targets
     //     | 'from' ('.' | '...')+ 'import' import_from_targets
@@ -785,15 +1002,16 @@ stmtP Parser::import_from() {
         } while (true);
         return dot_count + ellipsis_count * 3;
     };
-    if (expect("from")) {
+    if (expect(Keyword::From)) {
         auto level = count_level();
         if (level == 0) {
             // ('.' | '...')*
             if (auto module = dotted_name()) {
-                if (expect("import")) {
+                if (expect(Keyword::Import)) {
                     if (auto alias = import_from_targets()) {
-                        return make_unique<ImportFrom>(module, move(*alias),
-                                                       level);
+                        return spanned(
+                            p, make_unique<ImportFrom>(module, move(*alias),
+                                                       level));
                     }
                     reset(p);
                     return nullptr;
@@ -806,10 +1024,11 @@ stmtP Parser::import_from() {
         } else {
             // ('.' | '...')+
             if (auto module = dotted_name()) {
-                if (expect("import")) {
+                if (expect(Keyword::Import)) {
                     if (auto alias = import_from_targets()) {
-                        return make_unique<ImportFrom>(module, move(*alias),
-                                                       level);
+                        return spanned(
+                            p, make_unique<ImportFrom>(module, move(*alias),
+                                                       level));
                     }
                     reset(p);
                     return nullptr;
@@ -817,10 +1036,11 @@ stmtP Parser::import_from() {
                 reset(p);
                 return nullptr;
             }
-            if (expect("import")) {
+            if (expect(Keyword::Import)) {
                 if (auto alias = import_from_targets()) {
-                    return make_unique<ImportFrom>(nullopt, move(*alias),
-                                                   level);
+                    return spanned(
+                        p, make_unique<ImportFrom>(nullopt, move(*alias),
+                                                   level));
                 }
                 reset(p);
                 return nullptr;
@@ -834,6 +1054,7 @@ stmtP Parser::import_from() {
 }
 
 optional<vector<alias>> Parser::import_from_targets() {
+    PYSER_RULE("import_from_targets");
     // import_from_targets:
     //     | '(' import_from_as_names [','] ')'
     //     | import_from_as_names !','
@@ -864,7 +1085,7 @@ optional<vector<alias>> Parser::import_from_targets() {
         }
         return from_as_names;
     }
-    if (expect("*")) {
+    if (expect(Token::Type::STAR)) {
         return vector<alias>{alias("*", nullopt)};
     }
     reset(p);
@@ -872,11 +1093,12 @@ optional<vector<alias>> Parser::import_from_targets() {
 }
 
 optional<vector<alias>> Parser::import_from_as_names() {
+    PYSER_RULE("import_from_as_names");
     auto import_from_as_name = [this]() -> optional<alias> {
         // import_from_as_name:= NAME ['as' NAME]
         auto p = mark();
         if (auto n1 = expectN()) {
-            if (expect("as")) {
+            if (expect(Keyword::As)) {
                 if (auto n2 = expectN()) {
                     return alias(n1->id, n2->id);
                 }
@@ -904,9 +1126,10 @@ optional<vector<alias>> Parser::import_from_as_names() {
 stmtP Parser::raise_stmt() { return nullptr; }
 
 stmtP Parser::pass_stmt() {
+    PYSER_RULE("pass_stmt");
     int p = mark();
-    if (expect("pass")) {
-        return make_unique<Pass>();
+    if (expect(Keyword::Pass)) {
+        return spanned(p, make_unique<Pass>());
     }
     return nullptr;
 }
@@ -914,28 +1137,30 @@ stmtP Parser::pass_stmt() {
 stmtP Parser::del_stmt() { return nullptr; }
 
 stmtP Parser::yield_stmt() {
-    Logger::debug("yield stmt\n");
+    PYSER_RULE("yield_stmt");
     int p = mark();
     if (exprP e = yield_expr()) {
-        return make_unique<Expr>(move(e));
+        return spanned(p, make_unique<Expr>(move(e)));
     }
     reset(p);
     return nullptr;
 }
 
 stmtP Parser::assert_stmt() {
+    PYSER_RULE("assert_stmt");
     // assert_stmt: 'assert' expression [, expreesion]
     auto p = mark();
-    if (expect("assert")) {
+    if (expect(Keyword::Assert)) {
         if (auto test = expression()) {
             if (expectT(Token::Type::COMMA)) {
                 if (auto msg = expression()) {
-                    return make_unique<Assert>(move(test), move(msg));
+                    return spanned(
+                        p, make_unique<Assert>(move(test), move(msg)));
                 }
                 reset(p);
                 return nullptr;
             }
-            return make_unique<Assert>(move(test), nullptr);
+            return spanned(p, make_unique<Assert>(move(test), nullptr));
         }
     }
     reset(p);
@@ -951,85 +1176,95 @@ stmtP Parser::global_stmt() { return nullptr; }
 stmtP Parser::nonlocal_stmt() { return nullptr; }
 
 exprP Parser::atom() {
+    PYSER_RULE("atom");
     int p = mark();
     const Token& t = peek();
     if (keywords.count(t.raw)) {
         return nullptr;
     }
-    Logger::debug("atom rule\n");
     if (const Token& t = expectT(Token::Type::NAME)) {
         if (t.raw == "True") {
-            return make_unique<Bool>("True");
+            return spanned(p, make_unique<Bool>("True"));
         }
         if (t.raw == "False") {
-            return make_unique<Bool>("False");
+            return spanned(p, make_unique<Bool>("False"));
         }
         if (t.raw == "None") {
-            return make_unique<None>();
+            return spanned(p, make_unique<None>());
         }
 
-        Logger::debug("atom name: %s\n", t.raw.c_str());
-        return make_unique<Name>(t.raw, expr_context::Load);
+        PYSER_DEBUG("atom name: %s\n", t.raw.c_str());
+        return spanned(p, make_unique<Name>(t.raw, expr_context::Load));
     }
     if (const Token& t = expectT(Token::Type::STRING)) {
-        return make_unique<Str>(t.raw, nullopt);
+        optional<string> kind;
+        if (t.strFlags & STR_UNICODE) {
+            kind = "u";
+        }
+        if ((t.strFlags & STR_BYTES) &&
+            std::any_of(t.raw.begin(), t.raw.end(),
+                        [](char c) { return (unsigned char)c >= 0x80; })) {
+            error("SyntaxError: bytes can only contain ASCII literal "
+                  "characters",
+                  p);
+        }
+        return spanned(p, make_unique<Str>(t.raw, kind, t.strFlags));
     }
     if (const Token& t = expectT(Token::Type::NUMBER)) {
-        return make_unique<Num>(t.raw);
+        return spanned(p, make_unique<Num>(t.raw));
     }
     reset(p);
     return nullptr;
 }
 
+// The first slice is parsed once and only then told apart from the first
+// of a tuple; parsing it again would double the work at every level of
+// nested subscripts.
 exprP Parser::slices() {
+    PYSER_RULE("slices");
     int p = mark();
-    exprP s;
-
-    if ((s = slice()) && !lookahead(Token::Type::COMMA)) {
+    exprP s = slice();
+    if (!s) {
+        reset(p);
+        return nullptr;
+    }
+    if (!lookahead(Token::Type::COMMA)) {
         return s;
     }
 
-    reset(p);
     exprPs ss;
-    if ((s = slice()) && lookahead(Token::Type::COMMA)) {
+    ss.push_back(move(s));
+    int p1 = mark();
+    while ((p1 = mark()) && expect(Token::Type::COMMA) && (s = slice())) {
         ss.push_back(move(s));
-        int p1 = mark();
-        while ((p1 = mark()) && expect(Token::Type::COMMA) && (s = slice())) {
-            ss.push_back(move(s));
-        }
-        reset(p1);
-        expect(Token::Type::COMMA);
-        return make_unique<Tuple>(move(ss), expr_context::Load);
     }
-
-    reset(p);
-    return nullptr;
+    reset(p1);
+    expect(Token::Type::COMMA);
+    return spanned(p, make_unique<Tuple>(move(ss), expr_context::Load));
 }
 
+// slice:
+//	   | [expression] ':' [expression] [':' [expression] ]
+//	   | named_expression
+// The expression before the colon, if any, is the whole slice without one.
 exprP Parser::slice() {
+    PYSER_RULE("slice");
     int p = mark();
-    exprP lower;
-    exprP upper;
-    exprP step;
-
-    if ((lower = pratt_parser(), true) && expect(Token::Type::COLON)) {
-        if ((upper = pratt_parser(), true)) {
-            if (expect(Token::Type::COLON) && (step = pratt_parser(), true)) {
-                return make_unique<Slice>(move(lower), move(upper), move(step));
-            }
-            return make_unique<Slice>(move(lower), move(upper), nullptr);
+    exprP lower = pratt_parser();
+    if (!expect(Token::Type::COLON)) {
+        if (lower) {
+            return lower;
         }
-        return make_unique<Slice>(move(lower), nullptr, nullptr);
+        reset(p);
+        return nullptr;
     }
-    reset(p);
-
-    exprP e;
-    if (exprP e = pratt_parser()) {
-        return e;
+    exprP upper = pratt_parser();
+    if (expect(Token::Type::COLON)) {
+        exprP step = pratt_parser();
+        return spanned(
+            p, make_unique<Slice>(move(lower), move(upper), move(step)));
     }
-
-    reset(p);
-    return nullptr;
+    return spanned(p, make_unique<Slice>(move(lower), move(upper), nullptr));
 }
 
 // # NOTE: star_targets may contain *bitwise_or, targets may not.
@@ -1038,7 +1273,7 @@ exprP Parser::slice() {
 //	   | star_target (',' star_target )* [',']
 
 exprP Parser::star_targets() {
-    Logger::debug("star_targets\n");
+    PYSER_RULE("star_targets");
     int p = mark();
     if (exprP t = star_target()) {
         if (!lookahead(Token::Type::COMMA)) {
@@ -1054,7 +1289,7 @@ exprP Parser::star_targets() {
             ts.push_back(move(t));
         }
         reset(p1);
-        return make_unique<Tuple>(move(ts), expr_context::Store);
+        return spanned(p, make_unique<Tuple>(move(ts), expr_context::Store));
     }
 
     reset(p);
@@ -1065,12 +1300,13 @@ exprP Parser::star_targets() {
 //	   | '*' (!'*' star_target)
 //	   | target_with_star_atom
 exprP Parser::star_target() {
-    Logger::debug("star_target\n");
+    PYSER_RULE("star_target");
     int p = mark();
     if (expect(Token::Type::STAR) && !lookahead(Token::Type::STAR)) {
         exprP e = star_target();
         if (e) {
-            return make_unique<Starred>(move(e), expr_context::Store);
+            return spanned(
+                p, make_unique<Starred>(move(e), expr_context::Store));
         }
     }
 
@@ -1088,13 +1324,13 @@ exprP Parser::star_target() {
 //	   | t_primary '[' slices ']' !t_lookahead
 //	   | star_atom
 exprP Parser::target_with_star_atom() {
-    Logger::debug("target_with_star_atom\n");
+    PYSER_RULE("target_with_star_atom");
     int p = mark();
+    if (noTargetAt[p]) {
+        return nullptr;
+    }
     if (exprP t = t_primary()) {
-        expr* target = t.get();
-        if (Attribute* attr = dynamic_cast<Attribute*>(target)) {
-            return t;
-        } else if (Subscript* sub = dynamic_cast<Subscript*>(target)) {
+        if (t->kind == NodeKind::Attribute || t->kind == NodeKind::Subscript) {
             return t;
         }
     }
@@ -1103,12 +1339,13 @@ exprP Parser::target_with_star_atom() {
         return t;
     }
     reset(p);
+    noTargetAt[p] = true;
     return nullptr;
 }
 
 // star_targets_list_seq: ','.star_target+ [',']
 exprPs Parser::star_targets_list_seq() {
-    Logger::debug("star_targets_list_seq\n");
+    PYSER_RULE("star_targets_list_seq");
     int p = mark();
     exprP t;
     exprPs ts;
@@ -1131,7 +1368,7 @@ exprPs Parser::star_targets_list_seq() {
 //	   | star_target (',' star_target )+ [',']
 //	   | star_target ','
 exprPs Parser::star_targets_tuple_seq() {
-    Logger::debug("star_targets_tuple_seq\n");
+    PYSER_RULE("star_targets_tuple_seq");
     int p = mark();
     exprPs xs;
     exprP x;
@@ -1164,7 +1401,7 @@ exprPs Parser::star_targets_tuple_seq() {
 //	   | '(' [star_targets_tuple_seq] ')'
 //	   | '[' [star_targets_list_seq] ']'
 exprP Parser::star_atom() {
-    Logger::debug("star_atom\n");
+    PYSER_RULE("star_atom");
     int p = mark();
 
     if (unique_ptr<Name> name = expectN()) {
@@ -1172,18 +1409,31 @@ exprP Parser::star_atom() {
         return name;
     }
 
-    exprP a;
-    reset(p);
-    if (expect(Token::Type::LPAR) && (a = target_with_star_atom()) &&
-        expect(Token::Type::RPAR)) {
-        return a;
-    }
-
     reset(p);
     if (expect(Token::Type::LPAR)) {
-        exprPs ts = star_targets_tuple_seq();
+        int q = mark();
+        exprPs ts;
+        if (exprP a = target_with_star_atom()) {
+            if (expect(Token::Type::RPAR)) {
+                return a;
+            }
+            // the first target of the tuple, which star_target() would
+            // parse again: twice per level of nested tuples
+            ts.push_back(move(a));
+            int p1 = mark();
+            while ((p1 = mark()) && expect(Token::Type::COMMA) &&
+                   (a = star_target())) {
+                ts.push_back(move(a));
+            }
+            reset(p1);
+            expect(Token::Type::COMMA);
+        } else {
+            reset(q);
+            ts = star_targets_tuple_seq();
+        }
         if (expect(Token::Type::RPAR)) {
-            return make_unique<Tuple>(move(ts), expr_context::Store);
+            return spanned(
+                p, make_unique<Tuple>(move(ts), expr_context::Store));
         }
     }
 
@@ -1191,7 +1441,7 @@ exprP Parser::star_atom() {
     if (expect(Token::Type::LSQB)) {
         exprPs ts = star_targets_list_seq();
         if (expect(Token::Type::RSQB)) {
-            return make_unique<List>(move(ts), expr_context::Store);
+            return spanned(p, make_unique<List>(move(ts), expr_context::Store));
         }
     }
 
@@ -1,4 +1,7 @@
 #pragma once
+#include <bitset>
+#include <chrono>
+#include <climits>
 #include <memory>
 #include <optional>
 #include <string>
@@ -8,8 +11,11 @@
 #include <vector>
 
 #include "AST.h"
+#include "AllocStats.h"
+#include "StructuralHash.h"
 #include "Token.h"
 #include "Tokenizer.h"
+#include "Trace.h"
 
 using std::make_unique;
 using std::optional;
@@ -42,13 +48,141 @@ string assocToString();
 
 void initBindingPowerTables();
 
+// The words the grammar expects by name, in keywordNames order.
+enum class Keyword { As, Assert, Else, From, Import, Pass, While, Yield };
+
+inline constexpr const char* keywordNames[] = {
+    "as", "assert", "else", "from", "import", "pass", "while", "yield"};
+
+class Diagnostic {
+public:
+    Diagnostic(const string& message, int token, int line, int col)
+        : message(message), token(token), line(line), col(col) {}
+
+public:
+    string message;
+    // index of the offending token and where it starts
+    int token;
+    int line;
+    int col;
+};
+
+// Bounds on the work of one parse, for inputs that cannot be trusted.
+// Steps are rule invocations plus tokens read again after backtracking.
+// Rules check the limits on entry and reset() does on backtracking; the
+// deadline is only looked at every few hundred steps.
+class ParseLimits {
+public:
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::time_point::max();
+    uint64_t maxSteps = UINT64_MAX;
+    // nesting of grammar rules, operands of an operator chain counting as
+    // nested too, so it bounds the height of the tree as well
+    int maxDepth = INT_MAX;
+
+    // A maxDepth whose parse and tree walks fit a 2 MB thread stack with
+    // room to spare, even unoptimized: nested subscripts, the deepest
+    // shape per level, ran out at about 7000. The tools default to it.
+    static constexpr int safeDepth = 3000;
+};
+
+enum class ParseLimit { None, Deadline, Steps, Depth };
+
+class ParseResult {
+public:
+    bool ok() const { return diagnostics.empty(); }
+
+public:
+    // always set, holds the statements that could be parsed
+    unique_ptr<Module> module;
+    vector<Diagnostic> diagnostics;
+    // the limit that stopped the parse, if any
+    ParseLimit limit = ParseLimit::None;
+};
+
+// Nesting of the grammar rules, kept by PYSER_RULE.
+class RuleDepth {
+public:
+    RuleDepth(int& depth): depth(++depth) {}
+    ~RuleDepth() { depth--; }
+
+private:
+    int& depth;
+};
+
+// One pending operand of the iterative Pratt parser, what a recursive call
+// of pratt_parser_bp would be.
+class PrattFrame {
+public:
+    enum class State { Start, Resume, Operators };
+    // what the frame does with the right hand side it is waiting for
+    enum class Then { Prefix, BinOp, BoolOp, Compare, IfTest, IfElse };
+
+    PrattFrame(int minBP): minBP(minBP) {}
+
+public:
+    State state = State::Start;
+    Then then = Then::BinOp;
+    int minBP;
+    // where the frame started, rewound to when it fails
+    int p = 0;
+    // already counted by PYSER_RULE
+    bool entered = false;
+    // levels lhs grew by, each counted in the depth until the frame is done
+    int wraps = 0;
+    exprP lhs;
+    // lhs is a chain still growing, hashed only once it is done: hashing
+    // it at every operand would be quadratic in its length
+    bool lhsUnhashed = false;
+    exprP rhs;
+    // prefix operator
+    Token tok;
+    operator_ binaryOp{};
+    boolop boolOp{};
+    cmpop cmpOp{};
+    exprP test;
+    int rightBP = 0;
+};
+
 class Parser {
 public:
-    Parser() { initBindingPowerTables(); }
+    Parser() {
+        // the tables are shared by every parser, so are built only once
+        static bool tablesReady = (initBindingPowerTables(), true);
+        (void)tablesReady;
+    }
 
-    unique_ptr<ast> parse(const string& input) {
+    ParseResult parse(const string& input,
+                      const ParseLimits& limits = ParseLimits()) {
+        tokenize(input);
+        return parseTokens(limits);
+    }
+
+    // The two phases of parse(), for callers that time them separately.
+    size_t tokenize(const string& input) {
+        AllocScope scope(ALLOC_TOKENIZER);
         tokenizer.tokens = tokenizer.tokenize(input);
-        return file();
+        return tokenizer.tokens.size();
+    }
+
+    ParseResult parseTokens(const ParseLimits& limits = ParseLimits()) {
+        AllocScope scope(ALLOC_PARSER);
+        this->limits = limits;
+        limitHit = ParseLimit::None;
+        steps = 0;
+        nextClockCheck = 0;
+        depth = 0;
+        noTargetAt.assign(tokenizer.tokens.size() + 1, false);
+        // not reset(), which would count the tokens of the last parse as
+        // read again
+        tokenizer.reset(0);
+        diagnostics.clear();
+        farthest = -1;
+        ParseResult result;
+        result.module = file();
+        result.diagnostics = move(diagnostics);
+        result.limit = limitHit;
+        return result;
     }
 
     stmtP parseWhile(const string& input) {
@@ -61,6 +195,10 @@ public:
         return while_stmt();
     }
 
+public:
+    // false for normalized node hashes, identifiers left out
+    bool hashIdentifiers = true;
+
 private:
     bool expect(Token::Type type) {
         const Token& t = peek();
@@ -70,6 +208,7 @@ private:
             next();
             return true;
         } else {
+            expected(type);
             return false;
         }
     }
@@ -82,6 +221,7 @@ private:
             next();
             return t;
         } else {
+            expected(type);
             return Token();
         }
     }
@@ -90,19 +230,51 @@ private:
         const Token& t = peek();
         if (t.type == Token::Type::NAME) {
             next();
-            return make_unique<Name>(t.raw, expr_context::Load);
+            return spanned(mark() - 1,
+                           make_unique<Name>(t.raw, expr_context::Load));
         }
+        expected(Token::Type::NAME);
         return nullptr;
     }
 
-    bool expect(const string& tok) {
+    bool expect(Keyword word) {
         const Token& t = peek();
-        if (t.raw == tok) {
+        if (t.raw == keywordNames[size_t(word)]) {
             next();
             return true;
         } else {
+            expected(word);
+            return false;
+        }
+    }
+
+    // Every alternative that fails gets here, on successful parses too, so
+    // recording an expectation is only ever setting a bit.
+    void expected(Token::Type type) {
+        if (atFarthest()) {
+            expectedTypes.set(size_t(type));
+        }
+    }
+
+    void expected(Keyword word) {
+        if (atFarthest()) {
+            expectedKeywords.set(size_t(word));
+        }
+    }
+
+    // Whether the cursor is at or past the farthest failure, which it
+    // becomes.
+    bool atFarthest() {
+        int p = mark();
+        if (p < farthest) {
             return false;
         }
+        if (p > farthest) {
+            farthest = p;
+            expectedTypes.reset();
+            expectedKeywords.reset();
+        }
+        return true;
     }
 
     bool lookahead(Token::Type type) {
@@ -115,6 +287,29 @@ private:
     }
 
     unique_ptr<Module> file();
+    bool synchronize();
+    void syntaxError();
+    void error(const string& message, int token);
+    const Token& tokenAt(int p);
+    // Sets the span and the structural hash of a node whose children are
+    // complete, the span running from token `first` to the last token
+    // consumed.
+    template <class T> unique_ptr<T> spanned(int first, unique_ptr<T> node) {
+        finishNode(*node, first);
+        return node;
+    }
+    void finishNode(ast& node, int first);
+    void setSpan(ast& node, int first);
+    void hashNode(ast& node);
+    // Hashes the left hand side of a frame that a BoolOp or Compare chain
+    // left unhashed, once it is complete: before it becomes an operand or
+    // the value of the frame.
+    void settleLhs(PrattFrame& f) {
+        if (f.lhsUnhashed) {
+            hashNode(*f.lhs);
+            f.lhsUnhashed = false;
+        }
+    }
     optional<stmtPs> statements();
     optional<stmtPs> statement();
 
@@ -183,16 +378,89 @@ private:
 
     exprP pratt_parser();
     exprP pratt_parser_bp(int minBP);
+    bool prattStep(exprP& value);
+    // The frame of an operand is one rule deeper, like the call it stands
+    // for, so ParseLimits::maxDepth bounds expression nesting too.
+    void pushPrattFrame(int minBP) {
+        depth++;
+        prattStack.emplace_back(minBP);
+    }
+    // The left hand side of a frame became the operand of a new node. The
+    // tree is a level taller, which a recursive parser would have spent a
+    // rule on, so maxDepth bounds its height and whatever walks it
+    // recursively. False once over the limit, failing the frame.
+    bool deepen(PrattFrame& f) {
+        f.wraps++;
+        depth++;
+        return withinLimits(0);
+    }
 
     exprP slices();
     exprP slice();
 
 private:
     int mark() { return tokenizer.mark(); }
-    void reset(int p) { tokenizer.reset(p); }
-    Token peek() { return tokenizer.peek(); }
-    Token next() { return tokenizer.next(); }
+    void reset(int p) {
+        PYSER_PROFILE_RESET(mark() - p);
+        int rewound = mark() > p ? mark() - p : 0;
+        if (!withinLimits(rewound)) {
+            // once stopped, the cursor stays at the end so every rule and
+            // loop above gives up
+            p = int(tokenizer.tokens.size());
+        }
+        tokenizer.reset(p);
+    }
+
+    // Called by PYSER_RULE, false once a limit is hit.
+    bool enterRule() { return withinLimits(1); }
+
+    bool withinLimits(uint64_t n) {
+        if (limitHit != ParseLimit::None) {
+            return false;
+        }
+        steps += n;
+        if (steps > limits.maxSteps) {
+            return stop(ParseLimit::Steps);
+        }
+        if (depth > limits.maxDepth) {
+            return stop(ParseLimit::Depth);
+        }
+        if (steps >= nextClockCheck) {
+            nextClockCheck = steps + 256;
+            using Clock = std::chrono::steady_clock;
+            if (limits.deadline != Clock::time_point::max() &&
+                Clock::now() > limits.deadline) {
+                return stop(ParseLimit::Deadline);
+            }
+        }
+        return true;
+    }
+
+    bool stop(ParseLimit limit);
+
+    const Token& peek() { return tokenizer.peek(); }
+    const Token& next() { return tokenizer.next(); }
     Tokenizer tokenizer;
+    vector<Diagnostic> diagnostics;
+
+    // farthest token any rule failed at and what it expected there
+    int farthest = -1;
+    std::bitset<size_t(Token::Type::ENCODING) + 1> expectedTypes;
+    std::bitset<size_t(Keyword::Yield) + 1> expectedKeywords;
+
+    ParseLimits limits;
+    ParseLimit limitHit = ParseLimit::None;
+    uint64_t steps = 0;
+    uint64_t nextClockCheck = 0;
+    int depth = 0;
+
+    vector<PrattFrame> prattStack;
+
+    // Tokens target_with_star_atom() is known to fail at. star_atom() and
+    // star_target() both try it at the token after a parenthesis, so each
+    // level of nested parentheses would double the work of a failing
+    // target.
+    vector<bool> noTargetAt;
 
 private:
     static unordered_set<string> keywords;
@@ -0,0 +1,49 @@
+#include "PassManager.h"
+#include "RecursiveVisitor.h"
+#include <algorithm>
+#include <utility>
+
+void PassManager::add(AstPass& pass, std::initializer_list<NodeKind> kinds,
+                      bool leave) {
+    for (NodeKind kind : kinds) {
+        entering[size_t(kind)].push_back(&pass);
+        if (leave) {
+            leaving[size_t(kind)].push_back(&pass);
+        }
+    }
+}
+
+void PassManager::add(AstPass& pass, bool leave) {
+    for (size_t i = 0; i < NODE_KIND_COUNT; i++) {
+        entering[i].push_back(&pass);
+        if (leave) {
+            leaving[i].push_back(&pass);
+        }
+    }
+}
+
+// Preorder with an explicit stack, operator chains can be deeper than the
+// native one. A node with passes to leave it is pushed back under its
+// children, marked, and left once they are all off the stack.
+void PassManager::run(ast& root) {
+    vector<std::pair<ast*, bool>> stack{{&root, false}};
+    while (!stack.empty()) {
+        auto [node, done] = stack.back();
+        stack.pop_back();
+        size_t kind = size_t(node->kind);
+        if (done) {
+            leave(*node);
+            continue;
+        }
+        enter(*node);
+        if (!leaving[kind].empty()) {
+            stack.emplace_back(node, true);
+        }
+        // pushed in field order, reversed to come off in it
+        size_t first = stack.size();
+        forEachChild(*node, [&](auto& child) {
+            stack.emplace_back(child.get(), false);
+        });
+        std::reverse(stack.begin() + first, stack.end());
+    }
+}
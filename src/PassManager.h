@@ -0,0 +1,47 @@
+#pragma once
+
+#include "AST.h"
+#include <initializer_list>
+#include <vector>
+
+using std::vector;
+
+// A check or analysis run by a PassManager. It only sees nodes of the kinds
+// it subscribed to.
+class AstPass {
+public:
+    virtual ~AstPass() = default;
+    // before the children of the node
+    virtual void enter(ast&) {}
+    // after the subtree of the node, for passes added with `leave` set
+    virtual void leave(ast&) {}
+};
+
+// Runs any number of passes in a single walk of a tree. Every node kind has
+// its own list of subscribed passes, so a node costs nothing to the passes
+// that ignore it, and the tree goes through the cache once however many
+// passes there are. Passes are called in the order they were added.
+class PassManager {
+public:
+    void add(AstPass& pass, std::initializer_list<NodeKind> kinds,
+             bool leave = false);
+    // subscribed to every kind
+    void add(AstPass& pass, bool leave = false);
+    void run(ast& root);
+
+    // The passes subscribed to one node, for walks done by someone else.
+    void enter(ast& node) {
+        for (AstPass* pass : entering[size_t(node.kind)]) {
+            pass->enter(node);
+        }
+    }
+    void leave(ast& node) {
+        for (AstPass* pass : leaving[size_t(node.kind)]) {
+            pass->leave(node);
+        }
+    }
+
+private:
+    vector<AstPass*> entering[NODE_KIND_COUNT];
+    vector<AstPass*> leaving[NODE_KIND_COUNT];
+};
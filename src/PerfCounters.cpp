@@ -0,0 +1,171 @@
+#include "PerfCounters.h"
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+const char* perfEventName(PerfEvent event) {
+    switch (event) {
+    case PERF_CYCLES:
+        return "cycles";
+    case PERF_INSTRUCTIONS:
+        return "instructions";
+    case PERF_BRANCH_MISSES:
+        return "branch_misses";
+    case PERF_L1D_MISSES:
+        return "l1d_misses";
+    case PERF_LLC_MISSES:
+        return "llc_misses";
+    case PERF_DTLB_MISSES:
+        return "dtlb_misses";
+    default:
+        return "unknown";
+    }
+}
+
+PerfCounters& PerfCounters::local() {
+    thread_local PerfCounters counters;
+    return counters;
+}
+
+#ifdef __linux__
+
+static uint64_t cacheMiss(uint64_t cache) {
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+           (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+static void eventConfig(int event, perf_event_attr& attr) {
+    __u32& type = attr.type;
+    __u64& config = attr.config;
+    type = PERF_TYPE_HARDWARE;
+    switch (event) {
+    case PERF_CYCLES:
+        config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+    case PERF_INSTRUCTIONS:
+        config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+    case PERF_BRANCH_MISSES:
+        config = PERF_COUNT_HW_BRANCH_MISSES;
+        break;
+    case PERF_L1D_MISSES:
+        type = PERF_TYPE_HW_CACHE;
+        config = cacheMiss(PERF_COUNT_HW_CACHE_L1D);
+        break;
+    case PERF_LLC_MISSES:
+        type = PERF_TYPE_HW_CACHE;
+        config = cacheMiss(PERF_COUNT_HW_CACHE_LL);
+        break;
+    case PERF_DTLB_MISSES:
+        type = PERF_TYPE_HW_CACHE;
+        config = cacheMiss(PERF_COUNT_HW_CACHE_DTLB);
+        break;
+    }
+}
+
+// cache events go in a group of their own
+static int eventGroup(int event) { return event < PERF_L1D_MISSES ? 0 : 1; }
+
+PerfCounters::PerfCounters() {
+    for (int i = 0; i < PERF_EVENT_COUNT; i++) {
+        fds[i] = -1;
+        Group& g = groups[eventGroup(i)];
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        eventConfig(i, attr);
+        attr.disabled = g.leader < 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                           PERF_FORMAT_TOTAL_TIME_RUNNING;
+        // this thread, any cpu
+        int fd = int(syscall(SYS_perf_event_open, &attr, 0, -1, g.leader, 0));
+        if (fd < 0) {
+            if (!available() && error.empty()) {
+                error = strerror(errno);
+            }
+            continue;
+        }
+        fds[i] = fd;
+        g.events[g.opened++] = i;
+        if (g.leader < 0) {
+            g.leader = fd;
+            error.clear();
+        }
+    }
+    for (const Group& g : groups) {
+        if (g.leader >= 0) {
+            ioctl(g.leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(g.leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+    }
+}
+
+PerfCounters::~PerfCounters() {
+    for (int fd : fds) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+bool PerfCounters::available() const {
+    for (const Group& g : groups) {
+        if (g.leader >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+PerfSample PerfCounters::read() const {
+    PerfSample s;
+    for (const Group& g : groups) {
+        if (g.leader < 0) {
+            continue;
+        }
+        uint64_t buf[3 + PERF_EVENT_COUNT];
+        ssize_t n = ::read(g.leader, buf, sizeof(buf));
+        if (n < ssize_t(3 * sizeof(uint64_t)) || buf[0] != uint64_t(g.opened)) {
+            continue;
+        }
+        uint64_t enabled = buf[1];
+        uint64_t running = buf[2];
+        if (running == 0) {
+            continue;
+        }
+        for (int i = 0; i < g.opened; i++) {
+            uint64_t v = buf[3 + i];
+            if (running < enabled) {
+                v = uint64_t(double(v) * double(enabled) / double(running));
+            }
+            s.values[g.events[i]] = v;
+            s.mask |= 1u << g.events[i];
+        }
+    }
+    return s;
+}
+
+#else
+
+PerfCounters::PerfCounters() {
+    for (int& fd : fds) {
+        fd = -1;
+    }
+    error = "perf_event_open is Linux only";
+}
+
+PerfCounters::~PerfCounters() {}
+
+bool PerfCounters::available() const { return false; }
+
+PerfSample PerfCounters::read() const { return PerfSample(); }
+
+#endif
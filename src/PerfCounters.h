@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+using std::string;
+
+enum PerfEvent {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_BRANCH_MISSES,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_DTLB_MISSES,
+    PERF_EVENT_COUNT,
+};
+
+const char* perfEventName(PerfEvent event);
+
+// Counter values, only those in `mask` (bit per PerfEvent) were counted.
+class PerfSample {
+public:
+    bool has(int event) const { return mask & (1u << event); }
+
+    PerfSample operator-(const PerfSample& other) const {
+        PerfSample d;
+        d.mask = mask & other.mask;
+        for (int i = 0; i < PERF_EVENT_COUNT; i++) {
+            d.values[i] = d.has(i) ? values[i] - other.values[i] : 0;
+        }
+        return d;
+    }
+
+    PerfSample& operator+=(const PerfSample& other) {
+        if (!mask) {
+            mask = other.mask;
+        }
+        mask &= other.mask;
+        for (int i = 0; i < PERF_EVENT_COUNT; i++) {
+            values[i] = has(i) ? values[i] + other.values[i] : 0;
+        }
+        return *this;
+    }
+
+public:
+    uint32_t mask = 0;
+    uint64_t values[PERF_EVENT_COUNT] = {};
+};
+
+// Hardware counters of the calling thread, opened as perf_event groups so
+// the events of a group cover the same instructions: the core events in
+// one, the cache ones in another, each small enough to be scheduled next
+// to a counter the kernel keeps for itself, such as the NMI watchdog's.
+// Linux only; elsewhere, or where the kernel refuses, available() is false
+// and samples are empty. Events the CPU lacks are left out of their group
+// rather than failing it.
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // The counters of the calling thread, opened on first use.
+    static PerfCounters& local();
+
+    bool available() const;
+    // Totals since the groups were opened, scaled up if they were
+    // multiplexed. A group never scheduled so far is left out of the
+    // sample, its counters would only read 0.
+    PerfSample read() const;
+
+public:
+    // why the counters are unavailable
+    string error;
+
+private:
+    static constexpr int GROUP_COUNT = 2;
+
+    class Group {
+    public:
+        int leader = -1;
+        int opened = 0;
+        // events in the order the group reports them
+        int events[PERF_EVENT_COUNT];
+    };
+
+    Group groups[GROUP_COUNT];
+    int fds[PERF_EVENT_COUNT];
+};
@@ -0,0 +1,105 @@
+#include "PositionIndex.h"
+#include "RecursiveVisitor.h"
+#include <algorithm>
+
+void PositionIndex::build(ast& root) {
+    entries.clear();
+    // preorder, with an explicit stack as operator chains can be deeper
+    // than the native one
+    vector<ast*> stack{&root};
+    while (!stack.empty()) {
+        ast* node = stack.back();
+        stack.pop_back();
+        if (node->span.end > node->span.begin) {
+            entries.push_back({node->span.begin, node->span.end, node});
+        }
+        forEachChild(*node,
+                     [&](auto& child) { stack.push_back(child.get()); });
+    }
+    // a parent with the span of its child stays in front of it
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const Entry& a, const Entry& b) {
+                         return a.begin != b.begin ? a.begin < b.begin
+                                                   : a.end > b.end;
+                     });
+
+    leaves = 1;
+    while (leaves < entries.size()) {
+        leaves *= 2;
+    }
+    ends.assign(2 * leaves, 0);
+    for (size_t i = 0; i < entries.size(); i++) {
+        ends[leaves + i] = entries[i].end;
+    }
+    for (size_t i = leaves; i-- > 1;) {
+        ends[i] = std::max(ends[2 * i], ends[2 * i + 1]);
+    }
+}
+
+size_t PositionIndex::beginningBy(uint32_t offset) const {
+    return std::upper_bound(entries.begin(), entries.end(), offset,
+                            [](uint32_t offset, const Entry& e) {
+                                return offset < e.begin;
+                            }) -
+           entries.begin();
+}
+
+// The nodes containing an offset are a chain of ancestors, and among the
+// entries beginning by it the innermost is the last one still open, found
+// by climbing from that entry's leaf to the nearest left sibling subtree
+// reaching past the offset and descending its rightmost such path.
+ast* PositionIndex::innermostAt(uint32_t offset) const {
+    size_t count = beginningBy(offset);
+    if (count == 0) {
+        return nullptr;
+    }
+    size_t i = leaves + count - 1;
+    if (ends[i] <= offset) {
+        while (true) {
+            if (i == 1) {
+                return nullptr;
+            }
+            if (i % 2 == 1 && ends[i - 1] > offset) {
+                i--;
+                break;
+            }
+            i /= 2;
+        }
+        while (i < leaves) {
+            i = ends[2 * i + 1] > offset ? 2 * i + 1 : 2 * i;
+        }
+    }
+    return entries[i - leaves].node;
+}
+
+vector<ast*> PositionIndex::overlapping(uint32_t begin, uint32_t end) const {
+    vector<ast*> found;
+    size_t count = beginningBy(end > begin ? end - 1 : begin);
+    if (count == 0) {
+        return found;
+    }
+    // subtrees left to right, skipping those ending by `begin` and those
+    // past the entries beginning in range
+    class Range {
+    public:
+        size_t node;
+        size_t first;
+        size_t size;
+    };
+    vector<Range> stack{{1, 0, leaves}};
+    while (!stack.empty()) {
+        Range r = stack.back();
+        stack.pop_back();
+        if (r.first >= count || ends[r.node] <= begin) {
+            continue;
+        }
+        if (r.node >= leaves) {
+            found.push_back(entries[r.first].node);
+            continue;
+        }
+        size_t half = r.size / 2;
+        stack.push_back({2 * r.node + 1, r.first + half, half});
+        stack.push_back({2 * r.node, r.first, half});
+    }
+    return found;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "AST.h"
+#include <cstdint>
+#include <vector>
+
+using std::vector;
+
+// Source position queries over a parsed tree, for editors: the innermost
+// node at an offset and the nodes overlapping a range, in O(log n) plus the
+// size of the answer. Spans nest, so the nodes are kept sorted by where
+// they begin, outer ones first, next to an implicit tree holding the
+// furthest end of every run of them. Stale once the tree changes; build()
+// again after a reparse reuses the storage.
+class PositionIndex {
+public:
+    PositionIndex() = default;
+    explicit PositionIndex(ast& root) { build(root); }
+
+    void build(ast& root);
+    // nodes with a non-empty span
+    size_t size() const { return entries.size(); }
+
+    // Innermost node whose span contains the offset, nullptr if none.
+    ast* innermostAt(uint32_t offset) const;
+    // Nodes whose span overlaps [begin, end), outer ones first; an empty
+    // range stands for the nodes containing `begin`.
+    vector<ast*> overlapping(uint32_t begin, uint32_t end) const;
+
+private:
+    class Entry {
+    public:
+        uint32_t begin;
+        uint32_t end;
+        ast* node;
+    };
+
+    // entries [0, count) beginning at or before `offset`
+    size_t beginningBy(uint32_t offset) const;
+
+private:
+    vector<Entry> entries;
+    // furthest end below each node of a complete binary tree over the
+    // entries, leaves from `leaves` on
+    vector<uint32_t> ends;
+    size_t leaves = 0;
+};
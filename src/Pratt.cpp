@@ -1,12 +1,11 @@
 #include "Parser.h"
 #include "Token.h"
-#include "Logger.h"
+#include "Trace.h"
 #include <memory>
 #include <optional>
 #include <string>
 #include <unordered_map>
 #include <utility>
-#include <stdexcept>
 
 using std::make_unique;
 using std::optional;
@@ -43,7 +42,7 @@ unordered_map<Token, optional<BindingPower>> Parser::postfixTable;
 vector<tuple<Fix, Assoc, vector<Token>>> Parser::table;
 
 void Parser::initBindingPowerTables() {
-    Logger::debug("initBindingPowerTables\n");
+    PYSER_DEBUG("initBindingPowerTables\n");
     table = {
         // Precedence from low to high
 
@@ -135,144 +134,298 @@ void Parser::initBindingPowerTables() {
 }
 
 optional<BindingPower> Parser::prefix_binding_power(const Token& t) {
-    if (prefixTable.count(t)) {
-        return prefixTable[t];
+    auto it = prefixTable.find(t);
+    if (it != prefixTable.end()) {
+        return it->second;
     }
     return nullopt;
 }
 
 optional<BindingPower> Parser::post_binding_power(const Token& t) {
-    if (postfixTable.count(t)) {
-        return postfixTable[t];
+    auto it = postfixTable.find(t);
+    if (it != postfixTable.end()) {
+        return it->second;
     }
     return nullopt;
 }
 
 optional<BindingPower> Parser::infix_binding_power(const Token& t) {
-    if (infixTable.count(t)) {
-        return infixTable[t];
+    auto it = infixTable.find(t);
+    if (it != infixTable.end()) {
+        return it->second;
     }
     return nullopt;
 }
 
 exprP Parser::pratt_parser() { return pratt_parser_bp(0); }
 
+// Operator of an infix token that builds a BinOp. The tokens without one
+// (".", "(" and "[" when they do not make an Attribute or a Subscript) end
+// up in a BinOp with the default operator.
+static operator_ binaryOperator(const Token& t) {
+    switch (t.type) {
+    case Token::Type::MINUS:
+        return operator_::Sub;
+    case Token::Type::STAR:
+        return operator_::Mult;
+    case Token::Type::SLASH:
+        return operator_::Div;
+    case Token::Type::DOUBLESTAR:
+        return operator_::Pow;
+    case Token::Type::AT:
+        return operator_::MatMult;
+    case Token::Type::PERCENT:
+        return operator_::Mod;
+    case Token::Type::DOUBLESLASH:
+        return operator_::FloorDiv;
+    case Token::Type::LEFTSHIFT:
+        return operator_::LShift;
+    case Token::Type::RIGHTSHIFT:
+        return operator_::RShift;
+    case Token::Type::VBAR:
+        return operator_::BitOr;
+    case Token::Type::CIRCUMFLEX:
+        return operator_::BitXor;
+    case Token::Type::AMPER:
+        return operator_::BitAnd;
+    default:
+        return operator_::Add;
+    }
+}
+
+// Shift-reduce form of binding power parsing: every operand that would be a
+// recursive call is a frame on prattStack instead, so the native stack stays
+// the same however long or deeply nested the expression is. A frame parses
+// its own left hand side and the operators binding tighter than its minBP,
+// pushing a frame for each right hand side and resuming with its result.
 exprP Parser::pratt_parser_bp(int minBP) {
-    int p = mark();
-    const Token& tok = peek();
-    exprP lhs;
-    if (optional<BindingPower> bp = prefix_binding_power(tok)) {
-        next();
-        exprP rhs = pratt_parser_bp(*bp->right);
-        if (tok.type == Token::Type::STAR) {
-            optional<BindingPower> bitwiseOrBP =
-                infix_binding_power(Token(Token::Type::VBAR, "|"));
-            lhs = make_unique<Starred>(move(rhs), expr_context::Load);
-        } else if (tok.type == Token::Type::PLUS) {
-            lhs = make_unique<UnaryOp>(unaryop::UAdd, move(rhs));
-        } else if (tok.type == Token::Type::MINUS) {
-            lhs = make_unique<UnaryOp>(unaryop::USub, move(rhs));
-        } else if (tok.type == Token::Type::TILDE) {
-            lhs = make_unique<UnaryOp>(unaryop::Invert, move(rhs));
-        } else if (tok.type == Token::Type::NAME) {
-            if (tok.raw == "not") {
-                lhs = make_unique<UnaryOp>(unaryop::Not, move(rhs));
-            } else if (tok.raw == "await") {
-                lhs = make_unique<Await>(move(rhs));
-            }
+    PYSER_RULE("pratt_parser_bp");
+    // nested calls, through atom() or slices(), stack their frames on top
+    size_t base = prattStack.size();
+    prattStack.emplace_back(minBP);
+    prattStack.back().entered = true;
+    exprP value;
+    while (true) {
+        if (!prattStep(value)) {
+            continue;
+        }
+        depth -= prattStack.back().wraps;
+        if (!prattStack.back().entered) {
+            depth--;
+        }
+        prattStack.pop_back();
+        if (prattStack.size() == base) {
+            return value;
         }
-    } else {
-        lhs = atom();
+        PrattFrame& parent = prattStack.back();
+        parent.rhs = move(value);
+        parent.state = PrattFrame::State::Resume;
     }
+}
 
-    if (!lhs) {
-        reset(p);
-        return nullptr;
+// Runs the top frame until it either needs the value of a right hand side,
+// which it pushes a frame for, or is done and leaves its result in `value`.
+bool Parser::prattStep(exprP& value) {
+    // atom() and slices() may grow the stack, the frame is looked up again
+    // after them
+    PrattFrame* f = &prattStack.back();
+    switch (f->state) {
+    case PrattFrame::State::Start: {
+        // pratt_parser_bp used to be entered once per operand
+        if (!f->entered && !enterRule()) {
+            value = nullptr;
+            return true;
+        }
+        f->p = mark();
+        const Token& tok = peek();
+        if (optional<BindingPower> bp = prefix_binding_power(tok)) {
+            next();
+            f->tok = tok;
+            f->then = PrattFrame::Then::Prefix;
+            pushPrattFrame(*bp->right);
+            return false;
+        }
+        exprP lhs = atom();
+        f = &prattStack.back();
+        f->lhs = move(lhs);
+        if (!f->lhs) {
+            reset(f->p);
+            value = nullptr;
+            return true;
+        }
+        break;
     }
+    case PrattFrame::State::Resume: {
+        exprP rhs = move(f->rhs);
+        // an operator missing its operand fails the frame, like the
+        // expression it would have started
+        if (!rhs) {
+            reset(f->p);
+            value = nullptr;
+            return true;
+        }
+        switch (f->then) {
+        case PrattFrame::Then::Prefix: {
+            const Token& tok = f->tok;
+            if (tok.type == Token::Type::STAR) {
+                f->lhs = make_unique<Starred>(move(rhs), expr_context::Load);
+            } else if (tok.type == Token::Type::PLUS) {
+                f->lhs = make_unique<UnaryOp>(unaryop::UAdd, move(rhs));
+            } else if (tok.type == Token::Type::MINUS) {
+                f->lhs = make_unique<UnaryOp>(unaryop::USub, move(rhs));
+            } else if (tok.type == Token::Type::TILDE) {
+                f->lhs = make_unique<UnaryOp>(unaryop::Invert, move(rhs));
+            } else if (tok.type == Token::Type::NAME) {
+                if (tok.raw == "not") {
+                    f->lhs = make_unique<UnaryOp>(unaryop::Not, move(rhs));
+                } else if (tok.raw == "await") {
+                    f->lhs = make_unique<Await>(move(rhs));
+                }
+            }
+            if (!f->lhs) {
+                reset(f->p);
+                value = nullptr;
+                return true;
+            }
+            break;
+        }
+        case PrattFrame::Then::BinOp:
+            settleLhs(*f);
+            f->lhs = make_unique<BinOp>(move(f->lhs), f->binaryOp, move(rhs));
+            if (!deepen(*f)) {
+                reset(f->p);
+                value = nullptr;
+                return true;
+            }
+            break;
+        case PrattFrame::Then::BoolOp: {
+            // a run of the same operator extends the BoolOp of the frame
+            BoolOp* p = f->lhs->kind == NodeKind::BoolOp
+                            ? static_cast<BoolOp*>(f->lhs.get())
+                            : nullptr;
+            if (p && p->op == f->boolOp) {
+                p->values.push_back(move(rhs));
+            } else {
+                settleLhs(*f);
+                vector<exprP> values;
+                values.push_back(move(f->lhs));
+                values.push_back(move(rhs));
+                f->lhs = make_unique<BoolOp>(f->boolOp, move(values));
+                if (!deepen(*f)) {
+                    reset(f->p);
+                    value = nullptr;
+                    return true;
+                }
+            }
+            break;
+        }
+        case PrattFrame::Then::Compare: {
+            if (f->lhs->kind == NodeKind::Compare) {
+                Compare* p = static_cast<Compare*>(f->lhs.get());
+                p->ops.push_back(f->cmpOp);
+                p->comparators.push_back(move(rhs));
+            } else {
+                settleLhs(*f);
+                vector<cmpop> ops;
+                ops.push_back(f->cmpOp);
+                vector<exprP> comparators;
+                comparators.push_back(move(rhs));
+                f->lhs =
+                    make_unique<Compare>(move(f->lhs), ops, move(comparators));
+                if (!deepen(*f)) {
+                    reset(f->p);
+                    value = nullptr;
+                    return true;
+                }
+            }
+            break;
+        }
+        case PrattFrame::Then::IfTest:
+            f->test = move(rhs);
+            if (!expect(Keyword::Else)) {
+                syntaxError();
+                reset(f->p);
+                value = nullptr;
+                return true;
+            }
+            f->then = PrattFrame::Then::IfElse;
+            pushPrattFrame(f->rightBP);
+            return false;
+        case PrattFrame::Then::IfElse:
+            settleLhs(*f);
+            f->lhs = make_unique<IfExp>(move(f->test), move(f->lhs), move(rhs));
+            if (!deepen(*f)) {
+                reset(f->p);
+                value = nullptr;
+                return true;
+            }
+            break;
+        }
+        // the operand on the left, if any, starts where the frame did
+        if (f->then == PrattFrame::Then::BoolOp ||
+            f->then == PrattFrame::Then::Compare) {
+            setSpan(*f->lhs, f->p);
+            f->lhsUnhashed = true;
+        } else {
+            finishNode(*f->lhs, f->p);
+        }
+        break;
+    }
+    case PrattFrame::State::Operators:
+        break;
+    }
+    f->state = PrattFrame::State::Operators;
 
     while (true) {
         const Token& t = peek();
         optional<BindingPower> bp = infix_binding_power(t);
         if (!bp) {
-            Logger::debug("bp of %s is nullopt\n", t.toString().c_str());
+            PYSER_DEBUG("bp of %s is nullopt\n", t.toString().c_str());
             break;
         }
-        Logger::debug("while next token: %s, bp: %d, %d\n", t.toString().c_str(),
-               bp->left.value(), bp->right.value());
-        if (*bp->left < minBP) {
+        PYSER_DEBUG("while next token: %s, bp: %d, %d\n",
+                    t.toString().c_str(), bp->left.value(), bp->right.value());
+        if (*bp->left < f->minBP) {
             break;
         }
         next();
         if (t.is_operator()) {
-            operator_ op{};
-            bool done = false;
-            switch (t.type) {
-            case Token::Type::PLUS:
-                op = operator_::Add;
-                break;
-            case Token::Type::MINUS:
-                op = operator_::Sub;
-                break;
-            case Token::Type::STAR:
-                op = operator_::Mult;
-                break;
-            case Token::Type::SLASH:
-                op = operator_::Div;
-                break;
-            case Token::Type::DOUBLESTAR:
-                op = operator_::Pow;
-                break;
-            case Token::Type::DOT: {
+            if (t.type == Token::Type::DOT) {
+                settleLhs(*f);
                 if (const Token& attr = expectT(Token::Type::NAME)) {
-                    lhs = make_unique<Attribute>(move(lhs), attr.raw,
-                                                 expr_context::Load);
-                    done = true;
+                    f->lhs = make_unique<Attribute>(move(f->lhs), attr.raw,
+                                                   expr_context::Load);
+                    finishNode(*f->lhs, f->p);
+                    if (!deepen(*f)) {
+                        reset(f->p);
+                        value = nullptr;
+                        return true;
+                    }
+                    continue;
                 }
-            }
-            case Token::Type::LPAR: {
-                break;
-            }
-            case Token::Type::LSQB: {
+            } else if (t.type == Token::Type::LSQB) {
                 exprP rhs = slices();
+                f = &prattStack.back();
                 if (rhs) {
-                    lhs = make_unique<Subscript>(move(lhs), move(rhs),
-                                                 expr_context::Load);
-                    if (expect(Token::Type::RSQB)) {
-                        done = true;
-                        break;
-                    } else {
-                        throw std::runtime_error("expect ]");
+                    settleLhs(*f);
+                    f->lhs = make_unique<Subscript>(move(f->lhs), move(rhs),
+                                                   expr_context::Load);
+                    if (!expect(Token::Type::RSQB)) {
+                        syntaxError();
+                    } else if (deepen(*f)) {
+                        finishNode(*f->lhs, f->p);
+                        continue;
                     }
+                    reset(f->p);
+                    value = nullptr;
+                    return true;
                 }
-                break;
-            }
-            default:
-                break;
-            }
-            if (!done) {
-                exprP rhs = pratt_parser_bp(*bp->right);
-                lhs = make_unique<BinOp>(std::move(lhs), op, std::move(rhs));
             }
+            f->binaryOp = binaryOperator(t);
+            f->then = PrattFrame::Then::BinOp;
         } else if (t.is_boolop()) {
-            boolop op{};
-            if (t.raw == "and") {
-                op = boolop::And;
-            } else if (t.raw == "or") {
-                op = boolop::Or;
-            } else {
-                ; // impossible
-            }
-
-            exprP rhs = pratt_parser_bp(*bp->right);
-            BoolOp* p = dynamic_cast<BoolOp*>(lhs.get());
-            if (p && p->op == op) {
-                p->values.push_back(move(rhs));
-            } else {
-                vector<exprP> values;
-                values.push_back(move(lhs));
-                values.push_back(move(rhs));
-                lhs = make_unique<BoolOp>(op, move(values));
-            }
+            f->boolOp = t.raw == "and" ? boolop::And : boolop::Or;
+            f->then = PrattFrame::Then::BoolOp;
         } else if (t.is_cmpop()) {
             // { Eq, NotEq, Lt, LtE, Gt, GtE, Is, IsNot, In, NotIn};
             cmpop op{};
@@ -318,34 +471,23 @@ exprP Parser::pratt_parser_bp(int minBP) {
             default:
                 break;
             }
-            exprP rhs = pratt_parser_bp(*bp->right);
-            Compare* p = dynamic_cast<Compare*>(lhs.get());
-            if (p) {
-                p->ops.push_back(op);
-                p->comparators.push_back(move(rhs));
-            } else {
-                vector<cmpop> ops;
-                ops.push_back(op);
-                vector<exprP> comparators;
-                comparators.push_back(move(rhs));
-                lhs = make_unique<Compare>(move(lhs), ops, move(comparators));
-            }
+            f->cmpOp = op;
+            f->then = PrattFrame::Then::Compare;
         } else if (t.type == Token::Type::NAME && t.raw == "if") {
-            exprP test = pratt_parser_bp(*bp->right);
-            if (!expect("else")) {
-                throw std::runtime_error("expect else in if expr");
-            }
-            exprP orelse = pratt_parser_bp(*bp->right);
-            lhs = make_unique<IfExp>(move(test), move(lhs), move(orelse));
+            f->rightBP = *bp->right;
+            f->then = PrattFrame::Then::IfTest;
         } else {
             break;
         }
+        f->state = PrattFrame::State::Resume;
+        pushPrattFrame(*bp->right);
+        return false;
     }
 
-    if (lhs) {
-        return lhs;
+    settleLhs(*f);
+    value = move(f->lhs);
+    if (!value) {
+        reset(f->p);
     }
-
-    reset(p);
-    return nullptr;
+    return true;
 }
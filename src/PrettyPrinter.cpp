@@ -1,4 +1,5 @@
 #include "AST.h"
+#include "AllocStats.h"
 #include "PrettyPrinter.h"
 #include <cstdio>
 
@@ -107,15 +108,17 @@ string PrettyPrinter::cmpopToString(cmpop op) {
 }
 
 void PrettyPrinter::visit(Module& node) {
-    string s = "Module(\n";
+    AllocScope scope(ALLOC_PRINTER);
+    string& s = ctx.s;
+    s += "Module(\n";
     {
         ctx.level++;
         s += indent() + "body=[\n";
         {
             ctx.level++;
             for (size_t i = 0; i < node.body.size(); i++) {
-                node.body[i]->accept(*this);
-                s += indent() + ctx.s;
+                s += indent();
+                dispatch(*node.body[i]);
                 s += ",\n";
             }
             ctx.level--;
@@ -131,21 +134,22 @@ void PrettyPrinter::visit(Module& node) {
         ctx.level--;
     }
     s += indent() + ")";
-    ctx.s = s;
 }
 
 void PrettyPrinter::visit(While& node) {
-    string s = "While(\n";
+    string& s = ctx.s;
+    s += "While(\n";
     {
         ctx.level++;
-        node.test->accept(*this);
-        s += indent() + "test=" + ctx.s + ",\n";
+        s += indent() + "test=";
+        dispatch(*node.test);
+        s += ",\n";
         s += indent() + "body=[\n";
         {
             ctx.level++;
             for (size_t i = 0; i < node.body.size(); i++) {
-                node.body[i]->accept(*this);
-                s += indent() + ctx.s;
+                s += indent();
+                dispatch(*node.body[i]);
                 s += ",\n";
             }
             ctx.level--;
@@ -156,8 +160,7 @@ void PrettyPrinter::visit(While& node) {
         {
             ctx.level++;
             for (size_t i = 0; i < node.orelse.size(); i++) {
-                node.orelse[i]->accept(*this);
-                s += ctx.s;
+                dispatch(*node.orelse[i]);
                 s += ",\n";
             }
             ctx.level--;
@@ -166,21 +169,22 @@ void PrettyPrinter::visit(While& node) {
         ctx.level--;
     }
     s += indent() + ")";
-    ctx.s = s;
 }
 
 void PrettyPrinter::visit(If& node) {
-    string s = "If(\n";
+    string& s = ctx.s;
+    s += "If(\n";
     {
         ctx.level++;
-        node.test->accept(*this);
-        s += indent() + "test=" + ctx.s + ",\n";
+        s += indent() + "test=";
+        dispatch(*node.test);
+        s += ",\n";
         s += indent() + "body=[\n";
         {
             ctx.level++;
             for (size_t i = 0; i < node.body.size(); i++) {
-                node.body[i]->accept(*this);
-                s += indent() + ctx.s;
+                s += indent();
+                dispatch(*node.body[i]);
                 s += ",\n";
             }
             ctx.level--;
@@ -191,8 +195,7 @@ void PrettyPrinter::visit(If& node) {
         {
             ctx.level++;
             for (size_t i = 0; i < node.orelse.size(); i++) {
-                node.orelse[i]->accept(*this);
-                s += ctx.s;
+                dispatch(*node.orelse[i]);
                 s += ",\n";
             }
             ctx.level--;
@@ -201,39 +204,41 @@ void PrettyPrinter::visit(If& node) {
         ctx.level--;
     }
     s += indent() + ")";
-    ctx.s = s;
 }
 
 void PrettyPrinter::visit(Expr& node) {
-    string s = "Expr(\n";
+    string& s = ctx.s;
+    s += "Expr(\n";
     {
         ctx.level++;
         s += indent() + "value=";
-        node.value->accept(*this);
-        s += ctx.s + "\n";
+        dispatch(*node.value);
+        s += "\n";
         ctx.level--;
     }
     s += indent() + ")";
-    ctx.s = s;
 }
 
 void PrettyPrinter::visit(BinOp& node) {
-    string s = "BinOp(\n";
+    string& s = ctx.s;
+    s += "BinOp(\n";
     {
         ctx.level++;
-        node.left->accept(*this);
-        s += indent() + "left=" + ctx.s + ",\n";
+        s += indent() + "left=";
+        dispatch(*node.left);
+        s += ",\n";
         s += indent() + "op=" + operatorToString(node.op) + ",\n";
-        node.right->accept(*this);
-        s += indent() + "right=" + ctx.s + "\n";
+        s += indent() + "right=";
+        dispatch(*node.right);
+        s += "\n";
         ctx.level--;
     }
     s += indent() + ")";
-    ctx.s = s;
 }
 
 void PrettyPrinter::visit(BoolOp& node) {
-    string s = "BoolOp(\n";
+    string& s = ctx.s;
+    s += "BoolOp(\n";
     {
         ctx.level++;
         s += indent() + "op=" + boolopToString(node.op) + ",\n";
@@ -241,8 +246,9 @@ void PrettyPrinter::visit(BoolOp& node) {
         {
             ctx.level++;
             for (size_t i = 0; i < node.values.size(); i++) {
-                node.values[i]->accept(*this);
-                s += indent() + ctx.s + ",\n";
+                s += indent();
+                dispatch(*node.values[i]);
+                s += ",\n";
             }
             ctx.level--;
         }
@@ -250,28 +256,30 @@ void PrettyPrinter::visit(BoolOp& node) {
         ctx.level--;
     }
     s += indent() + ")";
-    ctx.s = s;
 }
 
 void PrettyPrinter::visit(UnaryOp& node) {
-    string s = "UnaryOp(\n";
+    string& s = ctx.s;
+    s += "UnaryOp(\n";
     {
         ctx.level++;
         s += indent() + "op=" + unaryopToString(node.op) + ",\n";
-        node.operand->accept(*this);
-        s += indent() + "operand=" + ctx.s + "\n";
+        s += indent() + "operand=";
+        dispatch(*node.operand);
+        s += "\n";
         ctx.level--;
     }
     s += indent() + ")";
-    ctx.s = s;
 }
 
 void PrettyPrinter::visit(Compare& node) {
-    string s = "Compare(\n";
+    string& s = ctx.s;
+    s += "Compare(\n";
     {
         ctx.level++;
-        node.left->accept(*this);
-        s += indent() + "left=" + ctx.s + ",\n";
+        s += indent() + "left=";
+        dispatch(*node.left);
+        s += ",\n";
         s += indent() + "ops=[\n";
         {
             ctx.level++;
@@ -285,8 +293,9 @@ void PrettyPrinter::visit(Compare& node) {
         {
             ctx.level++;
             for (size_t i = 0; i < node.comparators.size(); i++) {
-                node.comparators[i]->accept(*this);
-                s += indent() + ctx.s + ",\n";
+                s += indent();
+                dispatch(*node.comparators[i]);
+                s += ",\n";
             }
             ctx.level--;
         }
@@ -294,15 +303,14 @@ void PrettyPrinter::visit(Compare& node) {
         ctx.level--;
     }
     s += indent() + ")";
-    ctx.s = s;
 }
 
 void PrettyPrinter::visit(Str& node) {
-    ctx.s = "Constant(value=";
+    ctx.s += "Constant(value=";
     ctx.s += node.value + ", ";
     ctx.s += "kind=";
     if (node.kind) {
-        ctx.s += *node.kind;
+        ctx.s += "'" + *node.kind + "'";
     } else {
         ctx.s += "None";
     }
@@ -310,92 +318,99 @@ void PrettyPrinter::visit(Str& node) {
 }
 
 void PrettyPrinter::visit(Num& node) {
-    ctx.s = "Constant(value=" + node.value + ", kind=None)";
+    ctx.s += "Constant(value=" + node.value + ", kind=None)";
 }
 
 void PrettyPrinter::visit(Bool& node) {
-    ctx.s = "Constant(value=" + node.value + ", kind=None)";
+    ctx.s += "Constant(value=" + node.value + ", kind=None)";
 }
 
 void PrettyPrinter::visit(None& node) {
-    ctx.s = "Constant(value=None, kind=None)";
+    ctx.s += "Constant(value=None, kind=None)";
 }
 
 void PrettyPrinter::visit(Name& node) {
-    ctx.s = "Name(id='" + node.id + "', ctx=" + contextToString(node.ctx) + ")";
+    ctx.s += "Name(id='" + node.id + "', ctx=" + contextToString(node.ctx) +
+             ")";
 }
 
 void PrettyPrinter::visit(Await& node) {
-    string s = "Await(\n";
+    string& s = ctx.s;
+    s += "Await(\n";
     {
         ctx.level++;
-        node.value->accept(*this);
-        s += indent() + "value=" + ctx.s + "\n";
+        s += indent() + "value=";
+        dispatch(*node.value);
+        s += "\n";
         ctx.level--;
     }
     s += indent() + ")";
-    ctx.s = s;
 }
 
 void PrettyPrinter::visit(Attribute& node) {
-    string s = "Attribute(\n";
+    string& s = ctx.s;
+    s += "Attribute(\n";
     {
         ctx.level++;
-        node.value->accept(*this);
-        s += indent() + "value=" + ctx.s + ",\n";
+        s += indent() + "value=";
+        dispatch(*node.value);
+        s += ",\n";
         s += indent() + "attr='" + node.attr + "',\n";
         s += indent() + "ctx=" + contextToString(node.ctx) + ",\n";
         ctx.level--;
     }
     s += indent() + ")";
-    ctx.s = s;
 }
 
 void PrettyPrinter::visit(Subscript& node) {
-    string s = "Subscript(\n";
+    string& s = ctx.s;
+    s += "Subscript(\n";
     {
         ctx.level++;
-        node.value->accept(*this);
-        s += indent() + "value=" + ctx.s + ",\n";
-        node.slice->accept(*this);
-        s += indent() + "slice=" + ctx.s + ",\n";
+        s += indent() + "value=";
+        dispatch(*node.value);
+        s += ",\n";
+        s += indent() + "slice=";
+        dispatch(*node.slice);
+        s += ",\n";
         s += indent() + "ctx=" + contextToString(node.ctx) + ",\n";
         ctx.level--;
     }
     s += indent() + ")";
-    ctx.s = s;
 }
 
 void PrettyPrinter::visit(Call& node) {
-    string s = "Call(\n";
+    string& s = ctx.s;
+    s += "Call(\n";
     {
         ctx.level++;
         ctx.level--;
     }
     s += indent() + ")";
-    ctx.s = s;
 }
 
 void PrettyPrinter::visit(keyword& node) {
-    string s = "keyword(\n";
+    string& s = ctx.s;
+    s += "keyword(\n";
     {
         ctx.level++;
         ctx.level--;
     }
     s += indent() + ")";
-    ctx.s = s;
 }
 
 void PrettyPrinter::visit(List& node) {
-    string s = "List(\n";
+    string& s = ctx.s;
+    s += "List(\n";
     {
         ctx.level++;
         s += indent() + "elts=[\n";
         {
             ctx.level++;
             for (size_t i = 0; i < node.elts.size(); i++) {
-                node.elts[i]->accept(*this);
-                s += indent() + ctx.s + ",\n";
+                s += indent();
+                dispatch(*node.elts[i]);
+                s += ",\n";
             }
             ctx.level--;
         }
@@ -404,19 +419,20 @@ void PrettyPrinter::visit(List& node) {
         ctx.level--;
     }
     s += indent() + ")";
-    ctx.s = s;
 }
 
 void PrettyPrinter::visit(Tuple& node) {
-    string s = "Tuple(\n";
+    string& s = ctx.s;
+    s += "Tuple(\n";
     {
         ctx.level++;
         s += indent() + "elts=[\n";
         {
             ctx.level++;
             for (size_t i = 0; i < node.elts.size(); i++) {
-                node.elts[i]->accept(*this);
-                s += indent() + ctx.s + ",\n";
+                s += indent();
+                dispatch(*node.elts[i]);
+                s += ",\n";
             }
             ctx.level--;
         }
@@ -425,35 +441,37 @@ void PrettyPrinter::visit(Tuple& node) {
         ctx.level--;
     }
     s += indent() + ")";
-    ctx.s = s;
 }
 
 void PrettyPrinter::visit(Slice& node) {
-    string s = "Slice(\n";
+    string& s = ctx.s;
+    s += "Slice(\n";
     {
         ctx.level++;
-        string lo = "None";
+        s += indent() + "lower=";
         if (node.lower) {
-            node.lower->accept(*this);
-            lo = ctx.s;
+            dispatch(*node.lower);
+        } else {
+            s += "None";
         }
-        s += indent() + "lower=" + lo + ",\n";
-        string hi = "None";
+        s += ",\n";
+        s += indent() + "upper=";
         if (node.upper) {
-            node.upper->accept(*this);
-            hi = ctx.s;
+            dispatch(*node.upper);
+        } else {
+            s += "None";
         }
-        s += indent() + "upper=" + hi + ",\n";
-        string st = "None";
+        s += ",\n";
+        s += indent() + "step=";
         if (node.step) {
-            node.step->accept(*this);
-            st = ctx.s;
+            dispatch(*node.step);
+        } else {
+            s += "None";
         }
-        s += indent() + "step=" + st + "\n";
+        s += "\n";
         ctx.level--;
     }
     s += indent() + ")";
-    ctx.s = s;
 }
 
 void PrettyPrinter::visit(FunctionDef& node) {}
@@ -462,57 +480,64 @@ void PrettyPrinter::visit(Return& node) {}
 void PrettyPrinter::visit(Delete& node) {}
 
 void PrettyPrinter::visit(Assign& node) {
-    string s = "Assign(\n";
+    string& s = ctx.s;
+    s += "Assign(\n";
     {
         ctx.level++;
         s += indent() + "targets=[\n";
         {
             ctx.level++;
             for (size_t i = 0; i < node.targets.size(); i++) {
-                node.targets[i]->accept(*this);
-                s += indent() + ctx.s + ",\n";
+                s += indent();
+                dispatch(*node.targets[i]);
+                s += ",\n";
             }
             ctx.level--;
         }
         s += indent() + "],\n";
-        node.value->accept(*this);
-        s += indent() + "value=" + ctx.s + "\n";
+        s += indent() + "value=";
+        dispatch(*node.value);
+        s += "\n";
         ctx.level--;
     }
     s += indent() + ")";
-    ctx.s = s;
 }
 
 void PrettyPrinter::visit(AugAssign& node) {
-    string s = "AugAssign(\n";
+    string& s = ctx.s;
+    s += "AugAssign(\n";
     {
         ctx.level++;
-        node.target->accept(*this);
-        s += indent() + "target=" + ctx.s + ",\n";
+        s += indent() + "target=";
+        dispatch(*node.target);
+        s += ",\n";
         s += indent() + "op=" + operatorToString(node.op) + ",\n";
-        node.value->accept(*this);
-        s += indent() + "value=" + ctx.s + "\n";
+        s += indent() + "value=";
+        dispatch(*node.value);
+        s += "\n";
         ctx.level--;
     }
     s += indent() + ")";
-    ctx.s = s;
 }
 
 void PrettyPrinter::visit(AnnAssign& node) {
-    string s = "AnnAssign(\n";
+    string& s = ctx.s;
+    s += "AnnAssign(\n";
     {
         ctx.level++;
-        node.target->accept(*this);
-        s += indent() + "target=" + ctx.s + ",\n";
-        node.annotation->accept(*this);
-        s += indent() + "annotation=" + ctx.s + ",\n";
-        node.value->accept(*this);
-        s += indent() + "value=" + ctx.s + ",\n";
+        s += indent() + "target=";
+        dispatch(*node.target);
+        s += ",\n";
+        s += indent() + "annotation=";
+        dispatch(*node.annotation);
+        s += ",\n";
+        s += indent() + "value=";
+        dispatch(*node.value);
+        s += ",\n";
         s += indent() + "simple=" + std::to_string(node.simple) + ",\n";
         ctx.level--;
     }
     s += indent() + ")";
-    ctx.s = s;
 }
 
 void PrettyPrinter::visit(For& node) {}
@@ -520,41 +545,45 @@ void PrettyPrinter::visit(With& node) {}
 void PrettyPrinter::visit(Raise& node) {}
 void PrettyPrinter::visit(Try& node) {}
 void PrettyPrinter::visit(Assert& node) {
-    string s = "Assert(\n";
+    string& s = ctx.s;
+    s += "Assert(\n";
     {
         ctx.level++;
-        node.test->accept(*this);
-        s += indent() + "test=" + ctx.s + ",\n";
+        s += indent() + "test=";
+        dispatch(*node.test);
+        s += ",\n";
         if (node.msg) {
-            node.msg->accept(*this);
-            s += indent() + "msg=" + ctx.s + ",\n";
+            s += indent() + "msg=";
+            dispatch(*node.msg);
+            s += ",\n";
         } else {
             s += indent() + "msg=None,\n";
         }
         ctx.level--;
     }
     s += indent() + ")";
-    ctx.s = s;
 }
 void PrettyPrinter::visit(Import& node) {
-    string s = "Import(\n";
+    string& s = ctx.s;
+    s += "Import(\n";
     {
         ctx.level++;
         s += indent() + "names=[\n";
         ctx.level++;
         for (auto& n : node.names) {
+            s += indent();
             n.accept(*this);
-            s += indent() + ctx.s + ",\n";
+            s += ",\n";
         }
         ctx.level--;
         s += indent() + "],\n";
         ctx.level--;
     }
     s += indent() + ")";
-    ctx.s = s;
 }
 void PrettyPrinter::visit(ImportFrom& node) {
-    string s = "ImportFrom(\n";
+    string& s = ctx.s;
+    s += "ImportFrom(\n";
     {
         ctx.level++;
         {
@@ -563,8 +592,9 @@ void PrettyPrinter::visit(ImportFrom& node) {
             s += indent() + "names=[\n";
             ctx.level++;
             for (auto& n : node.aliases) {
+                s += indent();
                 n.accept(*this);
-                s += indent() + ctx.s + ",\n";
+                s += ",\n";
             }
             ctx.level--;
             s += indent() + "],\n";
@@ -573,13 +603,12 @@ void PrettyPrinter::visit(ImportFrom& node) {
         ctx.level--;
     }
     s += indent() + ")";
-    ctx.s = s;
 }
 void PrettyPrinter::visit(Global& node) {}
 void PrettyPrinter::visit(Nonlocal& node) {}
 
 void PrettyPrinter::visit(Pass& node) {
-    ctx.s = "Pass()";
+    ctx.s += "Pass()";
 }
 
 void PrettyPrinter::visit(Break& node) {}
@@ -587,69 +616,76 @@ void PrettyPrinter::visit(Continue& node) {}
 void PrettyPrinter::visit(Lambda& node) {}
 
 void PrettyPrinter::visit(IfExp& node) {
-    string s = "IfExp(\n";
+    string& s = ctx.s;
+    s += "IfExp(\n";
     {
         ctx.level++;
-        node.test->accept(*this);
-        s += indent() + "test=" + ctx.s + ",\n";
-        node.body->accept(*this);
-        s += indent() + "body=" + ctx.s + ",\n";
-        node.orelse->accept(*this);
-        s += indent() + "orelse=" + ctx.s + "\n";
+        s += indent() + "test=";
+        dispatch(*node.test);
+        s += ",\n";
+        s += indent() + "body=";
+        dispatch(*node.body);
+        s += ",\n";
+        s += indent() + "orelse=";
+        dispatch(*node.orelse);
+        s += "\n";
         ctx.level--;
     }
     s += indent() + ")";
-    ctx.s = s;
 }
 
 void PrettyPrinter::visit(Dict& node) {}
 void PrettyPrinter::visit(Set& node) {}
 
 void PrettyPrinter::visit(Yield& node) {
-    string s = "Yield(\n";
+    string& s = ctx.s;
+    s += "Yield(\n";
     {
         ctx.level++;
-        string value = "None";
+        s += indent() + "value=";
         if (node.value) {
-            node.value->accept(*this);
-            value = ctx.s;
+            dispatch(*node.value);
+        } else {
+            s += "None";
         }
-        s += indent() + "value=" + value + "\n";
+        s += "\n";
         ctx.level--;
     }
     s += indent() + ")";
-    ctx.s = s;
 }
 
 void PrettyPrinter::visit(YieldFrom& node) {
-    string s = "YieldFrom(\n";
+    string& s = ctx.s;
+    s += "YieldFrom(\n";
     {
         ctx.level++;
-        node.value->accept(*this);
-        s += indent() + "value=" + ctx.s + "\n";
+        s += indent() + "value=";
+        dispatch(*node.value);
+        s += "\n";
         ctx.level--;
     }
     s += indent() + ")";
-    ctx.s = s;
 }
 
 void PrettyPrinter::visit(Starred& node) {
-    string s = "Starred(\n";
+    string& s = ctx.s;
+    s += "Starred(\n";
     {
         ctx.level++;
-        node.value->accept(*this);
-        s += indent() + "value=" + ctx.s + "\n";
+        s += indent() + "value=";
+        dispatch(*node.value);
+        s += "\n";
         s += indent() + "ctx=" + contextToString(node.ctx) + "\n";
         ctx.level--;
     }
     s += indent() + ")";
-    ctx.s = s;
 }
 
 void PrettyPrinter::visit(arguments& node) {}
 void PrettyPrinter::visit(arg& node) {}
 void PrettyPrinter::visit(alias& node) {
-    string s = "alias(\n";
+    string& s = ctx.s;
+    s += "alias(\n";
     {
         ctx.level++;
         s += indent() + "name='" + node.name + "',\n";
@@ -663,8 +699,21 @@ void PrettyPrinter::visit(alias& node) {
         ctx.level--;
         s += indent() + ")";
     }
-    ctx.s = s;
 }
 void PrettyPrinter::visit(withitem& node) {}
 
-void PrettyPrinter::visit(NamedExpr& node) {}
+void PrettyPrinter::visit(NamedExpr& node) {
+    string& s = ctx.s;
+    s += "NamedExpr(\n";
+    {
+        ctx.level++;
+        s += indent() + "target=";
+        dispatch(*node.target);
+        s += ",\n";
+        s += indent() + "value=";
+        dispatch(*node.value);
+        s += "\n";
+        ctx.level--;
+    }
+    s += indent() + ")";
+}
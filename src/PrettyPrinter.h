@@ -2,6 +2,7 @@
 
 #include "Visitor.h"
 #include "AST.h"
+#include "StaticVisitor.h"
 #include <exception>
 #include <stdexcept>
 #include <string>
@@ -11,10 +12,17 @@ using std::string;
 
 struct PPContext {
     int level = 0;
+    // the output, every node appending itself in place: building each
+    // subtree apart and copying it into its parent costs the depth of the
+    // tree times its size
     string s;
 };
 
-class PrettyPrinter: public Visitor {
+// Still a Visitor for callers that go through ast::accept; children are
+// dispatched statically, which the class being final lets the compiler
+// resolve to direct calls.
+class PrettyPrinter final: public Visitor,
+                           public StaticVisitor<PrettyPrinter> {
 public:
     PPContext ctx;
 
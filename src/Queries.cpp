@@ -0,0 +1,119 @@
+#include "Queries.h"
+#include "PositionIndex.h"
+#include "RecursiveVisitor.h"
+#include "SourceFiles.h"
+#include "TreeIndex.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+class StringCollector: public RecursiveVisitor<StringCollector> {
+public:
+    using RecursiveVisitor<StringCollector>::visit;
+
+    void visit(Str& node) { found.push_back(&node); }
+
+    vector<Str*> found;
+};
+
+string quoted(const string& text, bool bytes) {
+    string out = "\"";
+    for (unsigned char c : text) {
+        switch (c) {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+            if (c < 0x20 || c == 0x7f || (bytes && c >= 0x80)) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\x%02x", c);
+                out += buf;
+            } else {
+                out += char(c);
+            }
+        }
+    }
+    return out + '"';
+}
+
+string position(const SourceLines& lines, uint32_t offset) {
+    return std::to_string(lines.line(offset)) + ":" +
+           std::to_string(lines.column(offset));
+}
+
+} // namespace
+
+string listStrings(Module& module, const string& source) {
+    StringCollector collector;
+    collector.walk(module);
+    // field order is not source order, a Dict has its keys before its values
+    std::stable_sort(collector.found.begin(), collector.found.end(),
+                     [](Str* a, Str* b) {
+                         return a->span.begin < b->span.begin;
+                     });
+    SourceLines lines(source);
+    string out;
+    for (Str* node : collector.found) {
+        out += position(lines, node->span.begin) + " " +
+               quoted(node->decoded(), node->flags & STR_BYTES) + '\n';
+    }
+    return out;
+}
+
+string describeNodeAt(Module& module, const string& source, uint32_t line,
+                      uint32_t column) {
+    SourceLines lines(source);
+    uint32_t offset = lines.offset(line, column);
+    ast* node = PositionIndex(module).innermostAt(offset);
+    if (!node) {
+        return std::to_string(line) + ":" + std::to_string(column) +
+               " no node\n";
+    }
+    TreeIndex tree(module);
+    const ast* statement = tree.enclosingStatement(*node);
+    const ast* scope = tree.enclosingScope(*node);
+    string out;
+    for (ast* n = node; n; n = tree.parent(*n)) {
+        out += position(lines, n->span.begin) + "-" +
+               position(lines, n->span.end) + " " + nodeKindName(n->kind) +
+               " depth " + std::to_string(tree.depth(*n)) + " preorder " +
+               std::to_string(tree.preorder(*n));
+        if (n == statement) {
+            out += " statement";
+        }
+        if (n == scope) {
+            out += " scope";
+        }
+        out += '\n';
+    }
+    return out;
+}
+
+string describeNodesIn(Module& module, const string& source,
+                       const uint32_t from[2], const uint32_t to[2]) {
+    SourceLines lines(source);
+    uint32_t begin = std::min<uint32_t>(lines.offset(from[0], from[1]),
+                                        uint32_t(source.size()));
+    uint32_t end = std::min<uint32_t>(lines.offset(to[0], to[1]),
+                                      uint32_t(source.size()));
+    string out;
+    for (ast* n : PositionIndex(module).overlapping(begin, end)) {
+        out += position(lines, n->span.begin) + "-" +
+               position(lines, n->span.end) + " " + nodeKindName(n->kind) +
+               '\n';
+    }
+    return out;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "AST.h"
+#include <string>
+
+// Reports pyser prints in place of the tree, one line per finding with its
+// position as LINE:COL, both counted from 1.
+
+// Every string literal in source order, "LINE:COL VALUE", VALUE being the
+// literal with its escapes resolved, in double quotes. Quotes, backslashes
+// and control characters are escaped again, as is every non-ASCII byte of a
+// bytes literal.
+string listStrings(Module& module, const string& source);
+
+// The innermost node at LINE:COL and its ancestors out to the module, one
+// "BEGIN-END KIND depth D preorder P" line each, BEGIN and END being
+// positions too; the innermost's enclosing statement and scope are marked
+// as such. "LINE:COL no node" where there is none.
+string describeNodeAt(Module& module, const string& source, uint32_t line,
+                      uint32_t column);
+
+// The nodes overlapping the source from `from` up to `to`, both LINE:COL
+// positions, the range taking in `from` but not `to`; an empty range
+// stands for the nodes containing `from`, and a position past the end of
+// its line for the end of the source. One "BEGIN-END KIND" line each, outer
+// nodes first.
+string describeNodesIn(Module& module, const string& source,
+                       const uint32_t from[2], const uint32_t to[2]);
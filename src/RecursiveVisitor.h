@@ -0,0 +1,236 @@
+#pragma once
+
+#include "AST.h"
+#include "StaticVisitor.h"
+#include <type_traits>
+#include <utility>
+
+// children(node, f) calls f with every non-null child slot of a node, the
+// unique_ptr<stmt> or unique_ptr<expr> owning it, in field order. keyword,
+// arguments and arg are not nodes of their own, their children are the
+// node's.
+template <class F, class T> void eachChild(F& f, unique_ptr<T>& slot) {
+    if (slot) {
+        f(slot);
+    }
+}
+
+template <class F> void eachChild(F& f, unique_ptr<keyword>& k) {
+    if (k) {
+        eachChild(f, k->value);
+    }
+}
+
+template <class F> void eachChild(F& f, unique_ptr<arg>& a) {
+    if (a) {
+        eachChild(f, a->annotation);
+    }
+}
+
+template <class F, class T> void eachChild(F& f, vector<unique_ptr<T>>& slots) {
+    for (unique_ptr<T>& slot : slots) {
+        eachChild(f, slot);
+    }
+}
+
+template <class F> void eachChild(F& f, unique_ptr<arguments>& a) {
+    if (a) {
+        eachChild(f, a->posonlyargs);
+        eachChild(f, a->args);
+        eachChild(f, a->vararg);
+        eachChild(f, a->kwonlyargs);
+        eachChild(f, a->kw_defaults);
+        eachChild(f, a->kwarg);
+        eachChild(f, a->defaults);
+    }
+}
+
+template <class F, class First, class... More>
+void eachChild(F& f, First& first, More&... more) {
+    eachChild(f, first);
+    (eachChild(f, more), ...);
+}
+
+template <class F> void children(Module& n, F&& f) { eachChild(f, n.body); }
+template <class F> void children(FunctionDef& n, F&& f) {
+    eachChild(f, n.args, n.body, n.decorator_list, n.returns);
+}
+template <class F> void children(ClassDef& n, F&& f) {
+    eachChild(f, n.bases, n.keywords, n.body, n.decorator_list);
+}
+template <class F> void children(Return& n, F&& f) { eachChild(f, n.value); }
+template <class F> void children(Delete& n, F&& f) { eachChild(f, n.targets); }
+template <class F> void children(Assign& n, F&& f) {
+    eachChild(f, n.targets, n.value);
+}
+template <class F> void children(AugAssign& n, F&& f) {
+    eachChild(f, n.target, n.value);
+}
+template <class F> void children(AnnAssign& n, F&& f) {
+    eachChild(f, n.target, n.annotation, n.value);
+}
+template <class F> void children(For& n, F&& f) {
+    eachChild(f, n.target, n.iter, n.body, n.orelse);
+}
+template <class F> void children(While& n, F&& f) {
+    eachChild(f, n.test, n.body, n.orelse);
+}
+template <class F> void children(If& n, F&& f) {
+    eachChild(f, n.test, n.body, n.orelse);
+}
+template <class F> void children(With&, F&&) {}
+template <class F> void children(Raise&, F&&) {}
+template <class F> void children(Try& n, F&& f) {
+    eachChild(f, n.exc, n.cause);
+}
+template <class F> void children(Assert& n, F&& f) {
+    eachChild(f, n.test, n.msg);
+}
+template <class F> void children(Import&, F&&) {}
+template <class F> void children(ImportFrom&, F&&) {}
+template <class F> void children(Global&, F&&) {}
+template <class F> void children(Nonlocal&, F&&) {}
+template <class F> void children(Expr& n, F&& f) { eachChild(f, n.value); }
+template <class F> void children(Pass&, F&&) {}
+template <class F> void children(Break&, F&&) {}
+template <class F> void children(Continue&, F&&) {}
+template <class F> void children(BoolOp& n, F&& f) { eachChild(f, n.values); }
+template <class F> void children(NamedExpr& n, F&& f) {
+    eachChild(f, n.target, n.value);
+}
+template <class F> void children(BinOp& n, F&& f) {
+    eachChild(f, n.left, n.right);
+}
+template <class F> void children(UnaryOp& n, F&& f) {
+    eachChild(f, n.operand);
+}
+template <class F> void children(Lambda&, F&&) {}
+template <class F> void children(IfExp& n, F&& f) {
+    eachChild(f, n.test, n.body, n.orelse);
+}
+template <class F> void children(Dict&, F&&) {}
+template <class F> void children(Set&, F&&) {}
+template <class F> void children(Await& n, F&& f) { eachChild(f, n.value); }
+template <class F> void children(Yield& n, F&& f) { eachChild(f, n.value); }
+template <class F> void children(YieldFrom& n, F&& f) {
+    eachChild(f, n.value);
+}
+template <class F> void children(Compare& n, F&& f) {
+    eachChild(f, n.left, n.comparators);
+}
+template <class F> void children(Call& n, F&& f) {
+    eachChild(f, n.func, n.args, n.keywords);
+}
+template <class F> void children(Num&, F&&) {}
+template <class F> void children(Str&, F&&) {}
+template <class F> void children(Bool&, F&&) {}
+template <class F> void children(None&, F&&) {}
+template <class F> void children(Attribute& n, F&& f) {
+    eachChild(f, n.value);
+}
+template <class F> void children(Subscript& n, F&& f) {
+    eachChild(f, n.value, n.slice);
+}
+template <class F> void children(Starred& n, F&& f) { eachChild(f, n.value); }
+template <class F> void children(Name&, F&&) {}
+template <class F> void children(List& n, F&& f) { eachChild(f, n.elts); }
+template <class F> void children(Tuple& n, F&& f) { eachChild(f, n.elts); }
+template <class F> void children(Slice& n, F&& f) {
+    eachChild(f, n.lower, n.upper, n.step);
+}
+
+// children() of a node of any class.
+template <class F> void forEachChild(ast& node, F&& f) {
+    switch (node.kind) {
+#define PYSER_CHILDREN_CASE(name)                                              \
+    case NodeKind::name:                                                       \
+        children(static_cast<name&>(node), f);                                 \
+        break;
+        PYSER_AST_NODES(PYSER_CHILDREN_CASE)
+#undef PYSER_CHILDREN_CASE
+    }
+}
+
+// Walks a whole tree, children in field order. Derived overrides visit for
+// the classes it cares about, with `using RecursiveVisitor<Derived>::visit;`
+// for the rest, and calls walkChildren(node) to go on below the node.
+// enter() runs before a node and leave() after its subtree; a false from
+// enter() skips both the node and its subtree.
+// The walk recurses, a few native frames per level of the tree, and a long
+// operator chain is a tree as deep as the chain: with an 8 MB stack, about
+// 100k levels are safe. ParseLimits::maxDepth bounds the height of a parsed
+// tree; PassManager walks trees of any depth.
+template <class Derived> class RecursiveVisitor: public StaticVisitor<Derived> {
+public:
+    void walk(ast& node) {
+        Derived& self = static_cast<Derived&>(*this);
+        if (!self.enter(node)) {
+            return;
+        }
+        this->dispatch(node);
+        self.leave(node);
+    }
+
+    // Walks a node and its subtree but for the statements of `body`, one
+    // of its bodies, which another walk covers. The tree is not touched.
+    void walkWithout(ast& node, const stmtPs& body) {
+        skipped = &body;
+        walk(node);
+        skipped = nullptr;
+    }
+
+    template <class N> void walkChildren(N& node) {
+        children(node, [this](auto& slot) {
+            if constexpr (std::is_same_v<std::decay_t<decltype(slot)>, stmtP>) {
+                if (skipped && &slot >= skipped->data() &&
+                    &slot < skipped->data() + skipped->size()) {
+                    return;
+                }
+            }
+            walk(*slot);
+        });
+    }
+
+    template <class N> void visit(N& node) { walkChildren(node); }
+
+    bool enter(ast&) { return true; }
+    void leave(ast&) {}
+
+private:
+    const stmtPs* skipped = nullptr;
+};
+
+// Rewrites a tree bottom-up, in place. Once the children of a node are
+// done, Derived's replace() overload for its class may return a node to put
+// in its slot instead; the default keeps it. Nodes are only moved or freed
+// where something is replaced. enter() returning false leaves a subtree
+// untouched. Recursive, with the same depth limit as RecursiveVisitor.
+template <class Derived> class Transformer {
+public:
+    // The root itself is only replaced by a node of the slot's type.
+    template <class T> void transform(unique_ptr<T>& slot) {
+        Derived& self = static_cast<Derived&>(*this);
+        if (!slot || !self.enter(*slot)) {
+            return;
+        }
+        forEachChild(*slot, [this](auto& child) { transform(child); });
+        switch (slot->kind) {
+#define PYSER_TRANSFORM_CASE(name)                                             \
+    case NodeKind::name:                                                       \
+        if constexpr (std::is_same_v<typename name::Category, T>) {            \
+            if (auto replacement = self.replace(static_cast<name&>(*slot))) {  \
+                slot = std::move(replacement);                                 \
+            }                                                                  \
+        }                                                                      \
+        break;
+            PYSER_AST_NODES(PYSER_TRANSFORM_CASE)
+#undef PYSER_TRANSFORM_CASE
+        }
+    }
+
+    template <class N> unique_ptr<typename N::Category> replace(N&) {
+        return nullptr;
+    }
+
+    bool enter(ast&) { return true; }
+};
@@ -0,0 +1,136 @@
+#include "RunStats.h"
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+uint64_t RunStats::peakRss() {
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return uint64_t(usage.ru_maxrss);
+#else
+    // kilobytes everywhere else
+    return uint64_t(usage.ru_maxrss) * 1024;
+#endif
+#else
+    return 0;
+#endif
+}
+
+void RunStats::merge(const RunStats& other) {
+    bytes += other.bytes;
+    tokens += other.tokens;
+    nodes += other.nodes;
+    files += other.files;
+    failedFiles += other.failedFiles;
+    allocs += other.allocs;
+    for (const auto& [name, c] : other.nodeClasses) {
+        nodeClasses[name] += c;
+    }
+    for (const PhaseTime& p : other.phases) {
+        size_t i = 0;
+        while (i < phases.size() && strcmp(phases[i].name, p.name) != 0) {
+            i++;
+        }
+        if (i < phases.size()) {
+            phases[i].seconds += p.seconds;
+            phases[i].counters += p.counters;
+        } else {
+            phases.push_back(p);
+        }
+    }
+}
+
+static double perSecond(uint64_t n, double seconds) {
+    return seconds > 0 ? double(n) / seconds : 0;
+}
+
+static void writeCounters(FILE* out, const char* key, const PerfSample& s,
+                          double scale) {
+    fprintf(out, ", \"%s\": {", key);
+    for (int i = 0; i < PERF_EVENT_COUNT; i++) {
+        fprintf(out, "%s\"%s\": ", i ? ", " : "", perfEventName(PerfEvent(i)));
+        // not counted, or its group never got on the PMU
+        if (s.has(i)) {
+            fprintf(out, "%.1f", double(s.values[i]) * scale);
+        } else {
+            fprintf(out, "null");
+        }
+    }
+    fprintf(out, "}");
+}
+
+void RunStats::writeJson(FILE* out) const {
+    double total = 0;
+    for (const PhaseTime& p : phases) {
+        total += p.seconds;
+    }
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"bytes\": %llu,\n", (unsigned long long)bytes);
+    fprintf(out, "  \"tokens\": %llu,\n", (unsigned long long)tokens);
+    fprintf(out, "  \"nodes\": %llu,\n", (unsigned long long)nodes);
+    fprintf(out, "  \"files\": %llu,\n", (unsigned long long)files);
+    fprintf(out, "  \"failed_files\": %llu,\n",
+            (unsigned long long)failedFiles);
+    fprintf(out, "  \"jobs\": %u,\n", jobs);
+    // throughput of the run as a whole, the phases' own is per thread
+    fprintf(out, "  \"wall_seconds\": %.9f,\n", wallSeconds);
+    fprintf(out, "  \"bytes_per_second\": %.1f,\n",
+            perSecond(bytes, wallSeconds));
+    fprintf(out, "  \"tokens_per_second\": %.1f,\n",
+            perSecond(tokens, wallSeconds));
+    fprintf(out, "  \"seconds\": %.9f,\n", total);
+    fprintf(out, "  \"peak_rss_bytes\": %llu,\n",
+            (unsigned long long)peakRss());
+    fprintf(out, "  \"phases\": [");
+    for (size_t i = 0; i < phases.size(); i++) {
+        const PhaseTime& p = phases[i];
+        fprintf(out,
+                "%s\n    {\"name\": \"%s\", \"seconds\": %.9f, "
+                "\"bytes_per_second\": %.1f, \"tokens_per_second\": %.1f",
+                i ? "," : "", p.name, p.seconds, perSecond(bytes, p.seconds),
+                perSecond(tokens, p.seconds));
+        if (perf) {
+            writeCounters(out, "counters", p.counters, 1);
+            writeCounters(out, "counters_per_mb", p.counters,
+                          bytes ? 1e6 / double(bytes) : 0);
+        }
+        fprintf(out, "}");
+    }
+    fprintf(out, "\n  ],\n");
+    fprintf(out, "  \"node_counts\": {");
+    bool first = true;
+    for (const auto& [name, c] : nodeClasses) {
+        fprintf(out, "%s\n    \"%s\": %llu", first ? "" : ",", name.c_str(),
+                (unsigned long long)c.count);
+        first = false;
+    }
+    fprintf(out, "\n  }");
+    if (AllocStats::enabled) {
+        double perKb = bytes ? 1024.0 / double(bytes) : 0;
+        fprintf(out, ",\n  \"allocations\": {\n");
+        fprintf(out, "    \"peak_live_bytes\": %llu,\n",
+                (unsigned long long)AllocStats::peakLiveBytes());
+        fprintf(out, "    \"per_kb\": %.1f,\n",
+                double(allocs.totalAllocations()) * perKb);
+        fprintf(out, "    \"subsystems\": {");
+        for (int i = 0; i < ALLOC_TAG_COUNT; i++) {
+            fprintf(out,
+                    "%s\n      \"%s\": {\"count\": %llu, \"bytes\": %llu, "
+                    "\"count_per_kb\": %.1f, \"bytes_per_kb\": %.1f}",
+                    i ? "," : "", allocTagName(AllocTag(i)),
+                    (unsigned long long)allocs.allocations[i],
+                    (unsigned long long)allocs.bytes[i],
+                    double(allocs.allocations[i]) * perKb,
+                    double(allocs.bytes[i]) * perKb);
+        }
+        fprintf(out, "\n    }\n  }");
+    }
+    fprintf(out, "\n}\n");
+}
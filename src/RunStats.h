@@ -0,0 +1,69 @@
+#pragma once
+
+#include "AllocStats.h"
+#include "AstStats.h"
+#include "PerfCounters.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+using std::map;
+using std::string;
+using std::vector;
+
+class PhaseTime {
+public:
+    PhaseTime(const char* name, double seconds, const PerfSample& counters)
+        : name(name), seconds(seconds), counters(counters) {}
+
+public:
+    const char* name;
+    double seconds;
+    PerfSample counters;
+};
+
+// What one run of pyser did and how long each phase of it took, written out
+// as JSON by --stats.
+class RunStats {
+public:
+    // Runs `f` as the phase `name` and records its wall time.
+    // With `perf` set, the hardware counters are read around it as well.
+    template <class F> void phase(const char* name, F&& f) {
+        PerfCounters* counters = perf ? &PerfCounters::local() : nullptr;
+        PerfSample before = counters ? counters->read() : PerfSample();
+        auto start = std::chrono::steady_clock::now();
+        f();
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        PerfSample after = counters ? counters->read() : PerfSample();
+        phases.emplace_back(name, elapsed.count(), after - before);
+    }
+
+    // Peak resident set size of the process so far, 0 where unknown.
+    static uint64_t peakRss();
+
+    // Adds up the counts and phase times of another run, files included.
+    void merge(const RunStats& other);
+    void writeJson(FILE* out) const;
+
+public:
+    bool perf = false;
+    uint64_t bytes = 0;
+    uint64_t tokens = 0;
+    uint64_t nodes = 0;
+    uint64_t files = 0;
+    // inputs that could not be read or parsed, counted in the phases they
+    // got through
+    uint64_t failedFiles = 0;
+    // of the whole run, set by the caller; the phase times are summed over
+    // the threads the files were spread on
+    double wallSeconds = 0;
+    unsigned jobs = 1;
+    map<string, NodeClassStats> nodeClasses;
+    vector<PhaseTime> phases;
+    // in builds with PYSER_ALLOC_STATS
+    AllocCounts allocs;
+};
@@ -0,0 +1,60 @@
+#include "SourceFiles.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+void addPath(const string& path, vector<string>& paths) {
+    std::error_code ec;
+    if (!std::filesystem::is_directory(path, ec)) {
+        paths.push_back(path);
+        return;
+    }
+    vector<string> found;
+    for (std::filesystem::recursive_directory_iterator it(path, ec), end;
+         !ec && it != end; it.increment(ec)) {
+        if (it->path().extension() == ".py" && it->is_regular_file(ec)) {
+            found.push_back(it->path().string());
+        }
+    }
+    // directory order is arbitrary
+    std::sort(found.begin(), found.end());
+    paths.insert(paths.end(), found.begin(), found.end());
+}
+
+bool addPathsFrom(const string& list, vector<string>& paths) {
+    std::ifstream in(list);
+    if (!in) {
+        return false;
+    }
+    for (string line; std::getline(in, line);) {
+        if (line.size()) {
+            addPath(line, paths);
+        }
+    }
+    return true;
+}
+
+SourceLines::SourceLines(const string& source) {
+    starts.push_back(0);
+    for (size_t i = 0; i < source.size(); i++) {
+        if (source[i] == '\n') {
+            starts.push_back(uint32_t(i + 1));
+        }
+    }
+}
+
+uint32_t SourceLines::line(uint32_t offset) const {
+    return uint32_t(std::upper_bound(starts.begin(), starts.end(), offset) -
+                    starts.begin());
+}
+
+bool readFile(const string& path, string& contents) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    contents.assign(std::istreambuf_iterator<char>{in},
+                    std::istreambuf_iterator<char>{});
+    return true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+// Collecting and reading the files the command line tools work on.
+
+// Appends a path, or the .py files under it if it is a directory, sorted.
+void addPath(const string& path, vector<string>& paths);
+// addPath() for every non-empty line of a list file, false if it cannot
+// be read.
+bool addPathsFrom(const string& list, vector<string>& paths);
+// The whole file, false if it cannot be opened.
+bool readFile(const string& path, string& contents);
+
+// Line and column of byte offsets in a source, both counted from 1, the
+// column in bytes.
+class SourceLines {
+public:
+    explicit SourceLines(const string& source);
+
+    uint32_t line(uint32_t offset) const;
+    uint32_t column(uint32_t offset) const {
+        return offset - starts[line(offset) - 1] + 1;
+    }
+    // UINT32_MAX past the end of the line or the last line
+    uint32_t offset(uint32_t line, uint32_t column) const {
+        if (line == 0 || line > starts.size() || column == 0 ||
+            (line < starts.size() &&
+             column > starts[line] - starts[line - 1])) {
+            return UINT32_MAX;
+        }
+        return starts[line - 1] + column - 1;
+    }
+
+private:
+    vector<uint32_t> starts;
+};
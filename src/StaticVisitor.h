@@ -0,0 +1,25 @@
+#pragma once
+
+#include "AST.h"
+
+// Visits nodes by switching on their NodeKind instead of going through
+// ast::accept and a virtual visit, so the dispatch is a jump table and the
+// handlers of Derived can be inlined into it. Handlers are named visit like
+// those of Visitor; with `using StaticVisitor<Derived>::visit;` the kinds
+// Derived has no handler for fall back to one that does nothing.
+template <class Derived, class Result = void> class StaticVisitor {
+public:
+    Result dispatch(ast& node) {
+        Derived& self = static_cast<Derived&>(*this);
+        switch (node.kind) {
+#define PYSER_DISPATCH_CASE(name)                                              \
+    case NodeKind::name:                                                       \
+        return self.visit(static_cast<name&>(node));
+            PYSER_AST_NODES(PYSER_DISPATCH_CASE)
+#undef PYSER_DISPATCH_CASE
+        }
+        return Result();
+    }
+
+    template <class Node> Result visit(Node&) { return Result(); }
+};
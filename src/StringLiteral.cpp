@@ -0,0 +1,223 @@
+#include "StringLiteral.h"
+#include <cstring>
+
+int classifyStringPrefix(const char* prefix, size_t n) {
+    if (n == 0 || n > 2) {
+        return -1;
+    }
+    int flags = 0;
+    for (size_t i = 0; i < n; i++) {
+        int f = 0;
+        switch (prefix[i]) {
+        case 'r':
+        case 'R':
+            f = STR_RAW;
+            break;
+        case 'b':
+        case 'B':
+            f = STR_BYTES;
+            break;
+        case 'u':
+        case 'U':
+            f = STR_UNICODE;
+            break;
+        case 'f':
+        case 'F':
+            f = STR_FORMATTED;
+            break;
+        default:
+            return -1;
+        }
+        if (flags & f) {
+            return -1;
+        }
+        flags |= f;
+    }
+    // Only r combines with another prefix letter.
+    if (n == 2 && !(flags & STR_RAW)) {
+        return -1;
+    }
+    if (n == 2 && (flags & STR_UNICODE)) {
+        return -1;
+    }
+    return flags;
+}
+
+uint8_t classifyStringQuotes(const char* begin, const char* end) {
+    uint8_t flags = 0;
+    char q = *begin;
+    if (q == '"') {
+        flags |= STR_DOUBLE_QUOTE;
+    }
+    if (end - begin >= 6 && begin[1] == q && begin[2] == q && end[-1] == q &&
+        end[-2] == q && end[-3] == q) {
+        flags |= STR_TRIPLE_QUOTE;
+    }
+    return flags;
+}
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static void appendUtf8(string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out.push_back(char(cp));
+    } else if (cp < 0x800) {
+        out.push_back(char(0xC0 | (cp >> 6)));
+        out.push_back(char(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out.push_back(char(0xE0 | (cp >> 12)));
+        out.push_back(char(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(char(0x80 | (cp & 0x3F)));
+    } else {
+        out.push_back(char(0xF0 | (cp >> 18)));
+        out.push_back(char(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back(char(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(char(0x80 | (cp & 0x3F)));
+    }
+}
+
+// Reads exactly `n` hex digits at `p`, or returns -1.
+static long readHex(const char* p, const char* end, int n) {
+    if (end - p < n) {
+        return -1;
+    }
+    long v = 0;
+    for (int i = 0; i < n; i++) {
+        int d = hexValue(p[i]);
+        if (d < 0) {
+            return -1;
+        }
+        v = v * 16 + d;
+    }
+    return v;
+}
+
+string decodeStringLiteral(const string& literal, uint8_t flags) {
+    const char* p = literal.data();
+    const char* end = p + literal.size();
+    while (p != end && *p != '\'' && *p != '"') {
+        p++;
+    }
+    size_t quote = (flags & STR_TRIPLE_QUOTE) ? 3 : 1;
+    if (size_t(end - p) < 2 * quote) {
+        return string();
+    }
+    p += quote;
+    end -= quote;
+
+    if (flags & STR_RAW) {
+        return string(p, end);
+    }
+
+    bool bytes = flags & STR_BYTES;
+    string out;
+    out.reserve(end - p);
+    while (p != end) {
+        const char* bs =
+            static_cast<const char*>(memchr(p, '\\', size_t(end - p)));
+        if (!bs) {
+            out.append(p, end);
+            break;
+        }
+        out.append(p, bs);
+        p = bs + 1;
+        if (p == end) {
+            out.push_back('\\');
+            break;
+        }
+        char c = *p++;
+        switch (c) {
+        case '\n':
+            break;
+        case '\\':
+        case '\'':
+        case '"':
+            out.push_back(c);
+            break;
+        case 'a':
+            out.push_back('\a');
+            break;
+        case 'b':
+            out.push_back('\b');
+            break;
+        case 'f':
+            out.push_back('\f');
+            break;
+        case 'n':
+            out.push_back('\n');
+            break;
+        case 'r':
+            out.push_back('\r');
+            break;
+        case 't':
+            out.push_back('\t');
+            break;
+        case 'v':
+            out.push_back('\v');
+            break;
+        case '0':
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7': {
+            uint32_t v = c - '0';
+            for (int i = 0; i < 2 && p != end && *p >= '0' && *p <= '7';
+                 i++) {
+                v = v * 8 + (*p++ - '0');
+            }
+            if (bytes) {
+                out.push_back(char(v & 0xFF));
+            } else {
+                appendUtf8(out, v);
+            }
+            break;
+        }
+        case 'x': {
+            long v = readHex(p, end, 2);
+            if (v < 0) {
+                out.append(p - 2, p);
+                break;
+            }
+            p += 2;
+            if (bytes) {
+                out.push_back(char(v));
+            } else {
+                appendUtf8(out, uint32_t(v));
+            }
+            break;
+        }
+        case 'u':
+        case 'U': {
+            int n = c == 'u' ? 4 : 8;
+            long v = bytes ? -1 : readHex(p, end, n);
+            if (v < 0 || v > 0x10FFFF) {
+                out.append(p - 2, p);
+                break;
+            }
+            p += n;
+            appendUtf8(out, uint32_t(v));
+            break;
+        }
+        default:
+            // Unknown escapes, and \N{...} which would need the Unicode
+            // name database, are kept as written.
+            out.append(p - 2, p);
+            break;
+        }
+    }
+    return out;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+using std::string;
+
+// Prefix and quote style of a STRING token, recorded by the tokenizer.
+enum StrFlag : uint8_t {
+    STR_RAW = 1 << 0,
+    STR_BYTES = 1 << 1,
+    STR_UNICODE = 1 << 2,
+    STR_FORMATTED = 1 << 3,
+    STR_DOUBLE_QUOTE = 1 << 4,
+    STR_TRIPLE_QUOTE = 1 << 5,
+};
+
+// Flags for a string prefix such as "rb" or "U", or -1 if `prefix` is not
+// a valid one.
+int classifyStringPrefix(const char* prefix, size_t n);
+
+// Quote flags for the literal text starting at its opening quote.
+uint8_t classifyStringQuotes(const char* begin, const char* end);
+
+// Resolves the escapes of a literal as written in source, prefix and
+// quotes included. Text between escapes is copied in bulk. \N{...} is kept
+// as written, naming characters would need the Unicode database.
+string decodeStringLiteral(const string& literal, uint8_t flags);
@@ -0,0 +1,163 @@
+#include "StructuralHash.h"
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+namespace {
+
+// A name given in the source, left out of normalized hashes.
+class Identifier {
+public:
+    const string& name;
+};
+
+// Writes the shallow description of a node. Strings and lists go with
+// their length and optional fields with a flag, so different shapes are
+// never described alike.
+class KeyWriter {
+public:
+    KeyWriter(string& key, bool identifiers)
+        : key(key), identifiers(identifiers) {
+        key.clear();
+    }
+
+    template <class... Fields> void operator()(const Fields&... fields) {
+        (add(fields), ...);
+    }
+
+    void add(uint64_t v) { key.append((const char*)&v, sizeof(v)); }
+    void add(const string& s) {
+        add(uint64_t(s.size()));
+        key += s;
+    }
+    void add(const optional<string>& s) {
+        add(uint64_t(bool(s)));
+        if (s) {
+            add(*s);
+        }
+    }
+    void add(Identifier id) {
+        if (identifiers) {
+            add(id.name);
+        }
+    }
+    template <class E> std::enable_if_t<std::is_enum_v<E>> add(E e) {
+        add(uint64_t(e));
+    }
+    template <class T> void add(const unique_ptr<T>& child) {
+        add(uint64_t(bool(child)));
+        if (child) {
+            add(child->hash);
+        }
+    }
+    void add(const unique_ptr<keyword>& k) {
+        add(uint64_t(bool(k)));
+        if (k) {
+            add(uint64_t(bool(k->arg)));
+            if (k->arg) {
+                add(Identifier{*k->arg});
+            }
+            add(k->value);
+        }
+    }
+    void add(const unique_ptr<arg>& a) {
+        add(uint64_t(bool(a)));
+        if (a) {
+            (*this)(Identifier{a->argu}, a->annotation);
+        }
+    }
+    void add(const unique_ptr<arguments>& a) {
+        add(uint64_t(bool(a)));
+        if (a) {
+            (*this)(a->posonlyargs, a->args, a->vararg, a->kwonlyargs,
+                    a->kw_defaults, a->kwarg, a->defaults);
+        }
+    }
+    void add(const alias& a) { (*this)(a.name, a.asname); }
+    template <class T> void add(const vector<T>& items) {
+        add(uint64_t(items.size()));
+        for (const T& item : items) {
+            add(item);
+        }
+    }
+
+private:
+    string& key;
+    bool identifiers;
+};
+
+// Fields of each class, in order, the expression context left out.
+template <class N> void fields(const N&, KeyWriter&) {}
+void fields(const Module& n, KeyWriter& w) { w(n.body); }
+void fields(const FunctionDef& n, KeyWriter& w) {
+    w(Identifier{n.name}, n.args, n.body, n.decorator_list, n.returns);
+}
+void fields(const ClassDef& n, KeyWriter& w) {
+    w(Identifier{n.name}, n.bases, n.keywords, n.body, n.decorator_list);
+}
+void fields(const Return& n, KeyWriter& w) { w(n.value); }
+void fields(const Delete& n, KeyWriter& w) { w(n.targets); }
+void fields(const Assign& n, KeyWriter& w) { w(n.targets, n.value); }
+void fields(const AugAssign& n, KeyWriter& w) { w(n.target, n.op, n.value); }
+void fields(const AnnAssign& n, KeyWriter& w) {
+    w(n.target, n.annotation, n.value, uint64_t(n.simple));
+}
+void fields(const For& n, KeyWriter& w) {
+    w(n.target, n.iter, n.body, n.orelse);
+}
+void fields(const While& n, KeyWriter& w) { w(n.test, n.body, n.orelse); }
+void fields(const If& n, KeyWriter& w) { w(n.test, n.body, n.orelse); }
+void fields(const Try& n, KeyWriter& w) { w(n.exc, n.cause); }
+void fields(const Assert& n, KeyWriter& w) { w(n.test, n.msg); }
+void fields(const Import& n, KeyWriter& w) { w(n.names); }
+void fields(const ImportFrom& n, KeyWriter& w) {
+    w(n.module, n.aliases, uint64_t(n.level));
+}
+void fields(const Expr& n, KeyWriter& w) { w(n.value); }
+void fields(const BoolOp& n, KeyWriter& w) { w(n.op, n.values); }
+void fields(const NamedExpr& n, KeyWriter& w) { w(n.target, n.value); }
+void fields(const BinOp& n, KeyWriter& w) { w(n.left, n.op, n.right); }
+void fields(const UnaryOp& n, KeyWriter& w) { w(n.op, n.operand); }
+void fields(const IfExp& n, KeyWriter& w) { w(n.test, n.body, n.orelse); }
+void fields(const Await& n, KeyWriter& w) { w(n.value); }
+void fields(const Yield& n, KeyWriter& w) { w(n.value); }
+void fields(const YieldFrom& n, KeyWriter& w) { w(n.value); }
+void fields(const Compare& n, KeyWriter& w) {
+    w(n.left, n.ops, n.comparators);
+}
+void fields(const Call& n, KeyWriter& w) { w(n.func, n.args, n.keywords); }
+void fields(const Num& n, KeyWriter& w) { w(n.value); }
+void fields(const Str& n, KeyWriter& w) { w(n.value, n.kind); }
+void fields(const Bool& n, KeyWriter& w) { w(n.value); }
+void fields(const Attribute& n, KeyWriter& w) {
+    w(n.value, Identifier{n.attr});
+}
+void fields(const Subscript& n, KeyWriter& w) { w(n.value, n.slice); }
+void fields(const Starred& n, KeyWriter& w) { w(n.value); }
+void fields(const Name& n, KeyWriter& w) { w(Identifier{n.id}); }
+void fields(const List& n, KeyWriter& w) { w(n.elts); }
+void fields(const Tuple& n, KeyWriter& w) { w(n.elts); }
+void fields(const Slice& n, KeyWriter& w) { w(n.lower, n.upper, n.step); }
+
+void describe(const ast& node, string& key, bool identifiers) {
+    KeyWriter w(key, identifiers);
+    w.add(uint64_t(node.kind));
+    switch (node.kind) {
+#define PYSER_FIELDS_CASE(name)                                                \
+    case NodeKind::name:                                                       \
+        fields(static_cast<const name&>(node), w);                             \
+        break;
+        PYSER_AST_NODES(PYSER_FIELDS_CASE)
+#undef PYSER_FIELDS_CASE
+    }
+}
+
+uint64_t hashKey(const string& key) { return std::hash<string>()(key); }
+
+} // namespace
+
+uint64_t structuralHash(const ast& node, bool identifiers) {
+    static thread_local string key;
+    describe(node, key, identifiers);
+    return hashKey(key);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "AST.h"
+#include <cstdint>
+#include <string>
+
+using std::string;
+
+// Structural hashes are computed bottom-up: the hash of a node covers its
+// kind, its own fields and the hashes of its children, so subtrees of the
+// same shape and content hash alike wherever they are. Spans and the
+// expression context are left out, a target hashing like the same
+// expression read. Normalized hashes leave out identifiers as well: names,
+// attributes, and the names of definitions, parameters and keyword
+// arguments, so code that only differs in naming hashes alike.
+
+// Hash of a node whose children already have theirs, hashed the same way.
+uint64_t structuralHash(const ast& node, bool identifiers = true);
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
 #include <string>
 
@@ -81,9 +82,17 @@ public:
     Token(): Token(Token::Type::ENDMARKER, "") {}
     Token(Token::Type type): type(type) {}
     Token(Token::Type type, const string& raw): type(type), raw(raw) {}
+    Token(Token::Type type, const string& raw, uint8_t strFlags)
+        : type(type), raw(raw), strFlags(strFlags) {}
 
     Token::Type type;
     string raw;
+    // STRING tokens only, a combination of StrFlag.
+    uint8_t strFlags = 0;
+    // where the token starts in the input, line is 1-based
+    int offset = 0;
+    int line = 0;
+    int col = 0;
 
     explicit operator bool() const { return type != Token::Type::ENDMARKER; }
 
@@ -6,10 +6,12 @@
 
 #include "Tokenizer.h"
 #include <cstdio>
+#include <cstring>
 #include <string>
 #include <vector>
 #include <stack>
 #include "Token.h"
+#include "StringLiteral.h"
 #include <iostream>
 
 using namespace std;
@@ -34,6 +36,7 @@ void processIndent(vector<Token>& toks, stack<int>& ind, int& nesting, char* lin
   int indent = whiteCount(line, end);
 
   if (indent == ind.top()) {
+      toks.push_back(Token(Token::Type::NEWLINE));
       return;
   }
 
@@ -51,8 +54,61 @@ void processIndent(vector<Token>& toks, stack<int>& ind, int& nesting, char* lin
   }
 }
 
+// Where the literal opened at `begin` ends, scanned as Python does: a
+// backslash escapes the character after it, newlines included, and only a
+// triple-quoted literal runs across lines. Null if nothing closes it, with
+// `stop` set to where the scan gave up: the end of the line, or of the input
+// for a triple-quoted literal.
+const char* stringEnd(const char* begin, const char* limit, const char*& stop) {
+  char q = *begin;
+  bool triple = limit - begin >= 3 && begin[1] == q && begin[2] == q;
+  const char* p = begin + (triple ? 3 : 1);
+  for (; p < limit; p++) {
+    if (*p == '\\') {
+      if (p + 1 < limit) {
+        p++;
+      }
+    } else if (*p == q) {
+      if (!triple) {
+        return p + 1;
+      }
+      if (limit - p >= 3 && p[1] == q && p[2] == q) {
+        return p + 3;
+      }
+    } else if (*p == '\n' && !triple) {
+      break;
+    }
+  }
+  stop = p;
+  return nullptr;
+}
+
+// Returns where the literal ends, the scan resumes from there.
+const char* processString(vector<Token>& toks, const char* input, const char* begin, const char* end) {
+  uint8_t flags = classifyStringQuotes(begin, end);
+
+  // a prefix such as rb'' has already been lexed as the NAME right before it,
+  // the string takes over its place and position
+  if (!toks.empty() && toks.back().type == Token::Type::NAME) {
+    Token& name = toks.back();
+    const char* prefix = begin - name.raw.size();
+    int prefixFlags = classifyStringPrefix(name.raw.data(), name.raw.size());
+    if (prefixFlags >= 0 && prefix >= input &&
+        name.raw.compare(0, name.raw.size(), prefix, name.raw.size()) == 0) {
+      name.type = Token::Type::STRING;
+      name.raw = string(prefix, end - prefix);
+      name.strFlags = flags | prefixFlags;
+      return end;
+    }
+  }
+
+  toks.push_back(Token(Token::Type::STRING, string(begin, end - begin), flags));
+  return end;
+}
+
 vector<Token> Tokenizer::tokenize(const string& input) {
     const char* str = input.c_str();
+    const char* limit = str + input.size();
     vector<Token> tokens;
     int nesting = 0;
     stack<int> ind;
@@ -60,18 +116,61 @@ vector<Token> Tokenizer::tokenize(const string& input) {
     const char *YYCURSOR = str;
     const char* YYMARKER;
     const char *t1, *t2, *t3;
+
+    // tokens pushed by a rule are stamped with where its match started
+    size_t stamped = 0;
+    const char* start = str;
+    const char* counted = str;
+    const char* lineStart = str;
+    int line = 1;
+    auto stamp = [&]() {
+        while (const char* nl = (const char*)memchr(counted, '\n', start - counted)) {
+            line++;
+            lineStart = counted = nl + 1;
+        }
+        counted = start;
+        for (; stamped < tokens.size(); stamped++) {
+            Token& t = tokens[stamped];
+            t.offset = start - str;
+            t.line = line;
+            t.col = start - lineStart;
+            // indentation is matched along with the newline before it but
+            // belongs to the next line
+            if (*start == '\n' && (t.type == Token::Type::INDENT ||
+                                   t.type == Token::Type::DEDENT)) {
+                t.offset++;
+                t.line++;
+                t.col = 0;
+            }
+        }
+    };
 again:
+    stamp();
+    start = YYCURSOR;
+    // literals are scanned by hand, not by rules
+    if (*YYCURSOR == '\'' || *YYCURSOR == '"') {
+        const char* stop;
+        if (const char* end = stringEnd(YYCURSOR, limit, stop)) {
+            YYCURSOR = processString(tokens, str, YYCURSOR, end);
+        } else {
+            // reported at the opening quotes, as Python does
+            char q = *YYCURSOR;
+            size_t quotes = YYCURSOR[1] == q && YYCURSOR[2] == q ? 3 : 1;
+            tokens.push_back(Token(Token::Type::ERRORTOKEN, string(YYCURSOR, quotes)));
+            YYCURSOR = stop;
+        }
+        goto again;
+    }
     
-#line 66 "Tokenizer.cpp"
+#line 166 "Tokenizer.cpp"
 const char *yyt1;
 const char *yyt2;
-#line 62 "./tokenizer.re2c"
+#line 162 "./tokenizer.re2c"
 
     
-#line 72 "Tokenizer.cpp"
+#line 172 "Tokenizer.cpp"
 {
 	char yych;
-	unsigned int yyaccept = 0;
 	yych = *YYCURSOR;
 	switch (yych) {
 		case 0x00: goto yy1;
@@ -79,23 +178,17 @@ const char *yyt2;
 		case '\n': goto yy5;
 		case ' ': goto yy7;
 		case '!': goto yy8;
-		case '"':
-			yyt1 = YYCURSOR;
-			goto yy9;
-		case '#': goto yy11;
-		case '%': goto yy13;
-		case '&': goto yy15;
-		case '\'':
-			yyt1 = YYCURSOR;
-			goto yy17;
-		case '(': goto yy19;
-		case ')': goto yy20;
-		case '*': goto yy21;
-		case '+': goto yy23;
-		case ',': goto yy25;
-		case '-': goto yy26;
-		case '.': goto yy28;
-		case '/': goto yy30;
+		case '#': goto yy9;
+		case '%': goto yy11;
+		case '&': goto yy13;
+		case '(': goto yy15;
+		case ')': goto yy16;
+		case '*': goto yy17;
+		case '+': goto yy19;
+		case ',': goto yy21;
+		case '-': goto yy22;
+		case '.': goto yy24;
+		case '/': goto yy26;
 		case '0':
 		case '1':
 		case '2':
@@ -107,13 +200,13 @@ const char *yyt2;
 		case '8':
 		case '9':
 			yyt1 = YYCURSOR;
-			goto yy32;
-		case ':': goto yy34;
-		case ';': goto yy36;
-		case '<': goto yy37;
-		case '=': goto yy39;
-		case '>': goto yy41;
-		case '@': goto yy43;
+			goto yy28;
+		case ':': goto yy30;
+		case ';': goto yy32;
+		case '<': goto yy33;
+		case '=': goto yy35;
+		case '>': goto yy37;
+		case '@': goto yy39;
 		case 'A':
 		case 'B':
 		case 'C':
@@ -168,185 +261,161 @@ const char *yyt2;
 		case 'y':
 		case 'z':
 			yyt1 = YYCURSOR;
-			goto yy45;
-		case '[': goto yy47;
-		case ']': goto yy48;
-		case '^': goto yy49;
-		case '{': goto yy51;
-		case '|': goto yy52;
-		case '}': goto yy54;
-		case '~': goto yy55;
+			goto yy41;
+		case '[': goto yy43;
+		case ']': goto yy44;
+		case '^': goto yy45;
+		case '{': goto yy47;
+		case '|': goto yy48;
+		case '}': goto yy50;
+		case '~': goto yy51;
 		default: goto yy2;
 	}
 yy1:
 	++YYCURSOR;
-#line 170 "./tokenizer.re2c"
+#line 254 "./tokenizer.re2c"
 	{
             processIndent(tokens, ind, nesting, (char*)YYCURSOR, (char*)YYCURSOR);
             tokens.push_back(Token(Token::Type::ENDMARKER));
         }
-#line 189 "Tokenizer.cpp"
+#line 282 "Tokenizer.cpp"
 yy2:
 	++YYCURSOR;
 yy3:
-#line 175 "./tokenizer.re2c"
+#line 259 "./tokenizer.re2c"
 	{ goto done; }
-#line 195 "Tokenizer.cpp"
+#line 288 "Tokenizer.cpp"
 yy4:
 	++YYCURSOR;
-#line 166 "./tokenizer.re2c"
+#line 249 "./tokenizer.re2c"
 	{ goto again; }
-#line 200 "Tokenizer.cpp"
+#line 293 "Tokenizer.cpp"
 yy5:
 	yych = *++YYCURSOR;
 	switch (yych) {
 		case '\t':
 		case ' ':
 			yyt1 = YYCURSOR;
-			goto yy56;
+			goto yy52;
 		case '\n':
 			yyt1 = YYCURSOR;
-			goto yy57;
+			goto yy53;
 		default: goto yy6;
 	}
 yy6:
-#line 168 "./tokenizer.re2c"
-	{ tokens.push_back(Token(Token::Type::NEWLINE)); goto again; }
-#line 216 "Tokenizer.cpp"
+#line 252 "./tokenizer.re2c"
+	{ processIndent(tokens, ind, nesting, (char*)YYCURSOR, (char*)YYCURSOR); goto again; }
+#line 309 "Tokenizer.cpp"
 yy7:
 	++YYCURSOR;
-#line 165 "./tokenizer.re2c"
+#line 248 "./tokenizer.re2c"
 	{ goto again; }
-#line 221 "Tokenizer.cpp"
+#line 314 "Tokenizer.cpp"
 yy8:
 	yych = *++YYCURSOR;
 	switch (yych) {
-		case '=': goto yy58;
+		case '=': goto yy54;
 		default: goto yy3;
 	}
 yy9:
-	yyaccept = 0;
-	yych = *(YYMARKER = ++YYCURSOR);
+	yych = *++YYCURSOR;
 	switch (yych) {
 		case '\n': goto yy10;
-		case '"': goto yy62;
-		default: goto yy59;
+		default: goto yy9;
 	}
 yy10:
-#line 87 "./tokenizer.re2c"
-	{ tokens.push_back(Token(Token::Type::ERRORTOKEN)); goto again; }
-#line 239 "Tokenizer.cpp"
+#line 246 "./tokenizer.re2c"
+	{ goto again; }
+#line 330 "Tokenizer.cpp"
 yy11:
 	yych = *++YYCURSOR;
 	switch (yych) {
-		case '\n': goto yy12;
-		default: goto yy11;
+		case '=': goto yy56;
+		default: goto yy12;
 	}
 yy12:
-#line 151 "./tokenizer.re2c"
-	{ goto again; }
-#line 249 "Tokenizer.cpp"
+#line 183 "./tokenizer.re2c"
+	{ tokens.push_back(Token(Token::Type::PERCENT, "%")); goto again; }
+#line 340 "Tokenizer.cpp"
 yy13:
 	yych = *++YYCURSOR;
 	switch (yych) {
-		case '=': goto yy64;
+		case '=': goto yy57;
 		default: goto yy14;
 	}
 yy14:
-#line 88 "./tokenizer.re2c"
-	{ tokens.push_back(Token(Token::Type::PERCENT, "%")); goto again; }
-#line 259 "Tokenizer.cpp"
-yy15:
-	yych = *++YYCURSOR;
-	switch (yych) {
-		case '=': goto yy65;
-		default: goto yy16;
-	}
-yy16:
-#line 89 "./tokenizer.re2c"
+#line 184 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::AMPER, "&")); goto again; }
-#line 269 "Tokenizer.cpp"
-yy17:
-	yyaccept = 1;
-	yych = *(YYMARKER = ++YYCURSOR);
-	switch (yych) {
-		case '\n': goto yy18;
-		default: goto yy67;
-	}
-yy18:
-#line 86 "./tokenizer.re2c"
-	{ tokens.push_back(Token(Token::Type::ERRORTOKEN)); goto again; }
-#line 280 "Tokenizer.cpp"
-yy19:
+#line 350 "Tokenizer.cpp"
+yy15:
 	++YYCURSOR;
-#line 90 "./tokenizer.re2c"
+#line 185 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::LPAR, "(")); nesting++; goto again; }
-#line 285 "Tokenizer.cpp"
-yy20:
+#line 355 "Tokenizer.cpp"
+yy16:
 	++YYCURSOR;
-#line 91 "./tokenizer.re2c"
+#line 186 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::RPAR, ")")); nesting--; goto again; }
-#line 290 "Tokenizer.cpp"
-yy21:
+#line 360 "Tokenizer.cpp"
+yy17:
 	yych = *++YYCURSOR;
 	switch (yych) {
-		case '*': goto yy70;
-		case '=': goto yy72;
-		default: goto yy22;
+		case '*': goto yy58;
+		case '=': goto yy60;
+		default: goto yy18;
 	}
-yy22:
-#line 92 "./tokenizer.re2c"
+yy18:
+#line 187 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::STAR, "*")); goto again; }
-#line 301 "Tokenizer.cpp"
-yy23:
+#line 371 "Tokenizer.cpp"
+yy19:
 	yych = *++YYCURSOR;
 	switch (yych) {
-		case '=': goto yy73;
-		default: goto yy24;
+		case '=': goto yy61;
+		default: goto yy20;
 	}
-yy24:
-#line 93 "./tokenizer.re2c"
+yy20:
+#line 188 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::PLUS, "+")); goto again; }
-#line 311 "Tokenizer.cpp"
-yy25:
+#line 381 "Tokenizer.cpp"
+yy21:
 	++YYCURSOR;
-#line 94 "./tokenizer.re2c"
+#line 189 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::COMMA, ",")); goto again; }
-#line 316 "Tokenizer.cpp"
-yy26:
+#line 386 "Tokenizer.cpp"
+yy22:
 	yych = *++YYCURSOR;
 	switch (yych) {
-		case '=': goto yy74;
-		case '>': goto yy75;
-		default: goto yy27;
+		case '=': goto yy62;
+		case '>': goto yy63;
+		default: goto yy23;
 	}
-yy27:
-#line 95 "./tokenizer.re2c"
+yy23:
+#line 190 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::MINUS, "-")); goto again; }
-#line 327 "Tokenizer.cpp"
-yy28:
-	yyaccept = 2;
+#line 397 "Tokenizer.cpp"
+yy24:
 	yych = *(YYMARKER = ++YYCURSOR);
 	switch (yych) {
-		case '.': goto yy76;
-		default: goto yy29;
+		case '.': goto yy64;
+		default: goto yy25;
 	}
-yy29:
-#line 96 "./tokenizer.re2c"
+yy25:
+#line 191 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::DOT, ".")); goto again; }
-#line 338 "Tokenizer.cpp"
-yy30:
+#line 407 "Tokenizer.cpp"
+yy26:
 	yych = *++YYCURSOR;
 	switch (yych) {
-		case '/': goto yy77;
-		case '=': goto yy79;
-		default: goto yy31;
+		case '/': goto yy65;
+		case '=': goto yy67;
+		default: goto yy27;
 	}
-yy31:
-#line 97 "./tokenizer.re2c"
+yy27:
+#line 192 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::SLASH, "/")); goto again; }
-#line 349 "Tokenizer.cpp"
-yy32:
+#line 418 "Tokenizer.cpp"
+yy28:
 	yych = *++YYCURSOR;
 	switch (yych) {
 		case '0':
@@ -358,77 +427,77 @@ yy32:
 		case '6':
 		case '7':
 		case '8':
-		case '9': goto yy32;
-		default: goto yy33;
+		case '9': goto yy28;
+		default: goto yy29;
 	}
-yy33:
+yy29:
 	t1 = yyt1;
 	t2 = YYCURSOR;
-#line 76 "./tokenizer.re2c"
+#line 173 "./tokenizer.re2c"
 	{
             tokens.push_back(Token(Token::Type::NUMBER, string(t1, t2 - t1)));
             goto again;
         }
-#line 373 "Tokenizer.cpp"
-yy34:
+#line 442 "Tokenizer.cpp"
+yy30:
 	yych = *++YYCURSOR;
 	switch (yych) {
-		case '=': goto yy80;
-		default: goto yy35;
+		case '=': goto yy68;
+		default: goto yy31;
 	}
-yy35:
-#line 98 "./tokenizer.re2c"
+yy31:
+#line 193 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::COLON, ":")); goto again; }
-#line 383 "Tokenizer.cpp"
-yy36:
+#line 452 "Tokenizer.cpp"
+yy32:
 	++YYCURSOR;
-#line 99 "./tokenizer.re2c"
+#line 194 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::SEMI, ";")); goto again; }
-#line 388 "Tokenizer.cpp"
-yy37:
+#line 457 "Tokenizer.cpp"
+yy33:
 	yych = *++YYCURSOR;
 	switch (yych) {
-		case '<': goto yy81;
-		case '=': goto yy83;
-		case '>': goto yy84;
-		default: goto yy38;
+		case '<': goto yy69;
+		case '=': goto yy71;
+		case '>': goto yy72;
+		default: goto yy34;
 	}
-yy38:
-#line 100 "./tokenizer.re2c"
+yy34:
+#line 195 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::LESS, "<")); goto again; }
-#line 400 "Tokenizer.cpp"
-yy39:
+#line 469 "Tokenizer.cpp"
+yy35:
 	yych = *++YYCURSOR;
 	switch (yych) {
-		case '=': goto yy85;
-		default: goto yy40;
+		case '=': goto yy73;
+		default: goto yy36;
 	}
-yy40:
-#line 101 "./tokenizer.re2c"
+yy36:
+#line 196 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::EQUAL, "=")); goto again; }
-#line 410 "Tokenizer.cpp"
-yy41:
+#line 479 "Tokenizer.cpp"
+yy37:
 	yych = *++YYCURSOR;
 	switch (yych) {
-		case '=': goto yy86;
-		case '>': goto yy87;
-		default: goto yy42;
+		case '=': goto yy74;
+		case '>': goto yy75;
+		default: goto yy38;
 	}
-yy42:
-#line 102 "./tokenizer.re2c"
+yy38:
+#line 197 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::GREATER, ">")); goto again; }
-#line 421 "Tokenizer.cpp"
-yy43:
+#line 490 "Tokenizer.cpp"
+yy39:
 	yych = *++YYCURSOR;
 	switch (yych) {
-		case '=': goto yy89;
-		default: goto yy44;
+		case '=': goto yy77;
+		default: goto yy40;
 	}
-yy44:
-#line 103 "./tokenizer.re2c"
+yy40:
+#line 198 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::AT, "@")); goto again; }
-#line 431 "Tokenizer.cpp"
-yy45:
+#line 500 "Tokenizer.cpp"
+yy41:
 	yych = *++YYCURSOR;
 	switch (yych) {
 		case '0':
@@ -493,388 +562,259 @@ yy45:
 		case 'w':
 		case 'x':
 		case 'y':
-		case 'z': goto yy45;
-		default: goto yy46;
+		case 'z': goto yy41;
+		default: goto yy42;
 	}
-yy46:
+yy42:
 	t1 = yyt1;
 	t2 = YYCURSOR;
-#line 81 "./tokenizer.re2c"
+#line 178 "./tokenizer.re2c"
 	{
             tokens.push_back(Token(Token::Type::NAME, string(t1, t2 - t1)));
             goto again;
         }
-#line 508 "Tokenizer.cpp"
-yy47:
+#line 577 "Tokenizer.cpp"
+yy43:
 	++YYCURSOR;
-#line 104 "./tokenizer.re2c"
+#line 199 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::LSQB, "[")); nesting++; goto again; }
-#line 513 "Tokenizer.cpp"
-yy48:
+#line 582 "Tokenizer.cpp"
+yy44:
 	++YYCURSOR;
-#line 105 "./tokenizer.re2c"
+#line 200 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::RSQB, "]")); nesting--; goto again; }
-#line 518 "Tokenizer.cpp"
-yy49:
+#line 587 "Tokenizer.cpp"
+yy45:
 	yych = *++YYCURSOR;
 	switch (yych) {
-		case '=': goto yy90;
-		default: goto yy50;
+		case '=': goto yy78;
+		default: goto yy46;
 	}
-yy50:
-#line 106 "./tokenizer.re2c"
+yy46:
+#line 201 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::CIRCUMFLEX, "^")); goto again; }
-#line 528 "Tokenizer.cpp"
-yy51:
+#line 597 "Tokenizer.cpp"
+yy47:
 	++YYCURSOR;
-#line 107 "./tokenizer.re2c"
+#line 202 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::LBRACE, "{")); nesting++; goto again; }
-#line 533 "Tokenizer.cpp"
-yy52:
+#line 602 "Tokenizer.cpp"
+yy48:
 	yych = *++YYCURSOR;
 	switch (yych) {
-		case '=': goto yy91;
-		default: goto yy53;
+		case '=': goto yy79;
+		default: goto yy49;
 	}
-yy53:
-#line 108 "./tokenizer.re2c"
+yy49:
+#line 203 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::VBAR, "|")); goto again; }
-#line 543 "Tokenizer.cpp"
-yy54:
+#line 612 "Tokenizer.cpp"
+yy50:
 	++YYCURSOR;
-#line 109 "./tokenizer.re2c"
+#line 204 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::RBRACE, "}")); nesting--; goto again; }
-#line 548 "Tokenizer.cpp"
-yy55:
+#line 617 "Tokenizer.cpp"
+yy51:
 	++YYCURSOR;
-#line 110 "./tokenizer.re2c"
+#line 205 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::TILDE, "~")); goto again; }
-#line 553 "Tokenizer.cpp"
-yy56:
+#line 622 "Tokenizer.cpp"
+yy52:
 	yych = *++YYCURSOR;
 	switch (yych) {
 		case '\t':
-		case ' ': goto yy56;
-		case '\n': goto yy57;
+		case ' ': goto yy52;
+		case '\n': goto yy53;
 		default:
 			yyt2 = YYCURSOR;
-			goto yy92;
+			goto yy80;
 	}
-yy57:
+yy53:
 	++YYCURSOR;
 	t2 = yyt1;
 	t1 = yyt1 - 1;
 	t3 = YYCURSOR - 1;
-#line 140 "./tokenizer.re2c"
+#line 235 "./tokenizer.re2c"
 	{
             YYCURSOR = t3;
             goto again;
         }
-#line 574 "Tokenizer.cpp"
-yy58:
+#line 643 "Tokenizer.cpp"
+yy54:
 	++YYCURSOR;
-#line 112 "./tokenizer.re2c"
+#line 207 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::NOTEQUAL, "!=")); goto again; }
-#line 579 "Tokenizer.cpp"
-yy59:
-	yych = *++YYCURSOR;
-yy60:
-	switch (yych) {
-		case '\n': goto yy61;
-		case '"': goto yy94;
-		default: goto yy59;
-	}
-yy61:
+#line 648 "Tokenizer.cpp"
+yy55:
 	YYCURSOR = YYMARKER;
-	switch (yyaccept) {
-		case 0: goto yy10;
-		case 1: goto yy18;
-		case 2: goto yy29;
-		case 3: goto yy63;
-		case 4: goto yy69;
-		default: goto yy109;
-	}
-yy62:
-	yyaccept = 3;
-	yych = *(YYMARKER = ++YYCURSOR);
-	switch (yych) {
-		case '\n': goto yy63;
-		case '"': goto yy95;
-		default: goto yy59;
-	}
-yy63:
-	t1 = yyt1;
-#line 157 "./tokenizer.re2c"
-	{
-            tokens.push_back(Token(Token::Type::STRING, string(t1, YYCURSOR - t1)));
-            goto again;
-        }
-#line 613 "Tokenizer.cpp"
-yy64:
+	goto yy25;
+yy56:
 	++YYCURSOR;
-#line 113 "./tokenizer.re2c"
+#line 208 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::PERCENTEQUAL, "%=")); goto again; }
-#line 618 "Tokenizer.cpp"
-yy65:
+#line 656 "Tokenizer.cpp"
+yy57:
 	++YYCURSOR;
-#line 114 "./tokenizer.re2c"
+#line 209 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::AMPEREQUAL, "&=")); goto again; }
-#line 623 "Tokenizer.cpp"
-yy66:
-	yych = *++YYCURSOR;
-yy67:
-	switch (yych) {
-		case '\n': goto yy61;
-		case '\'': goto yy68;
-		default: goto yy66;
-	}
-yy68:
-	yyaccept = 4;
-	yych = *(YYMARKER = ++YYCURSOR);
-	switch (yych) {
-		case '\n': goto yy69;
-		case '\'': goto yy68;
-		default: goto yy66;
-	}
-yy69:
-	t1 = yyt1;
-#line 161 "./tokenizer.re2c"
-	{
-            tokens.push_back(Token(Token::Type::STRING, string(t1, YYCURSOR - t1)));
-            goto again;
-        }
-#line 647 "Tokenizer.cpp"
-yy70:
+#line 661 "Tokenizer.cpp"
+yy58:
 	yych = *++YYCURSOR;
 	switch (yych) {
-		case '=': goto yy96;
-		default: goto yy71;
+		case '=': goto yy82;
+		default: goto yy59;
 	}
-yy71:
-#line 115 "./tokenizer.re2c"
+yy59:
+#line 210 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::DOUBLESTAR, "**")); goto again; }
-#line 657 "Tokenizer.cpp"
-yy72:
+#line 671 "Tokenizer.cpp"
+yy60:
 	++YYCURSOR;
-#line 116 "./tokenizer.re2c"
+#line 211 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::STAREQUAL, "*=")); goto again; }
-#line 662 "Tokenizer.cpp"
-yy73:
+#line 676 "Tokenizer.cpp"
+yy61:
 	++YYCURSOR;
-#line 117 "./tokenizer.re2c"
+#line 212 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::PLUSEQUAL, "+=")); goto again; }
-#line 667 "Tokenizer.cpp"
-yy74:
+#line 681 "Tokenizer.cpp"
+yy62:
 	++YYCURSOR;
-#line 118 "./tokenizer.re2c"
+#line 213 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::MINEQUAL, "-=")); goto again; }
-#line 672 "Tokenizer.cpp"
-yy75:
+#line 686 "Tokenizer.cpp"
+yy63:
 	++YYCURSOR;
-#line 119 "./tokenizer.re2c"
+#line 214 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::RARROW, "->")); goto again; }
-#line 677 "Tokenizer.cpp"
-yy76:
+#line 691 "Tokenizer.cpp"
+yy64:
 	yych = *++YYCURSOR;
 	switch (yych) {
-		case '.': goto yy97;
-		default: goto yy61;
+		case '.': goto yy83;
+		default: goto yy55;
 	}
-yy77:
+yy65:
 	yych = *++YYCURSOR;
 	switch (yych) {
-		case '=': goto yy98;
-		default: goto yy78;
+		case '=': goto yy84;
+		default: goto yy66;
 	}
-yy78:
-#line 120 "./tokenizer.re2c"
+yy66:
+#line 215 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::DOUBLESLASH, "//")); goto again; }
-#line 693 "Tokenizer.cpp"
-yy79:
+#line 707 "Tokenizer.cpp"
+yy67:
 	++YYCURSOR;
-#line 121 "./tokenizer.re2c"
+#line 216 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::SLASHEQUAL, "/=")); goto again; }
-#line 698 "Tokenizer.cpp"
-yy80:
+#line 712 "Tokenizer.cpp"
+yy68:
 	++YYCURSOR;
-#line 122 "./tokenizer.re2c"
+#line 217 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::COLONEQUAL, ":=")); goto again; }
-#line 703 "Tokenizer.cpp"
-yy81:
+#line 717 "Tokenizer.cpp"
+yy69:
 	yych = *++YYCURSOR;
 	switch (yych) {
-		case '=': goto yy99;
-		default: goto yy82;
+		case '=': goto yy85;
+		default: goto yy70;
 	}
-yy82:
-#line 123 "./tokenizer.re2c"
+yy70:
+#line 218 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::LEFTSHIFT, "<<")); goto again; }
-#line 713 "Tokenizer.cpp"
-yy83:
+#line 727 "Tokenizer.cpp"
+yy71:
 	++YYCURSOR;
-#line 124 "./tokenizer.re2c"
+#line 219 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::LESSEQUAL, "<=")); goto again; }
-#line 718 "Tokenizer.cpp"
-yy84:
+#line 732 "Tokenizer.cpp"
+yy72:
 	++YYCURSOR;
-#line 125 "./tokenizer.re2c"
+#line 220 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::NOTEQUAL, "<>")); goto again; }
-#line 723 "Tokenizer.cpp"
-yy85:
+#line 737 "Tokenizer.cpp"
+yy73:
 	++YYCURSOR;
-#line 126 "./tokenizer.re2c"
+#line 221 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::EQEQUAL, "==")); goto again; }
-#line 728 "Tokenizer.cpp"
-yy86:
+#line 742 "Tokenizer.cpp"
+yy74:
 	++YYCURSOR;
-#line 127 "./tokenizer.re2c"
+#line 222 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::GREATEREQUAL, ">=")); goto again; }
-#line 733 "Tokenizer.cpp"
-yy87:
+#line 747 "Tokenizer.cpp"
+yy75:
 	yych = *++YYCURSOR;
 	switch (yych) {
-		case '=': goto yy100;
-		default: goto yy88;
+		case '=': goto yy86;
+		default: goto yy76;
 	}
-yy88:
-#line 128 "./tokenizer.re2c"
+yy76:
+#line 223 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::RIGHTSHIFT, ">>")); goto again; }
-#line 743 "Tokenizer.cpp"
-yy89:
+#line 757 "Tokenizer.cpp"
+yy77:
 	++YYCURSOR;
-#line 129 "./tokenizer.re2c"
+#line 224 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::ATEQUAL, "@=")); goto again; }
-#line 748 "Tokenizer.cpp"
-yy90:
+#line 762 "Tokenizer.cpp"
+yy78:
 	++YYCURSOR;
-#line 130 "./tokenizer.re2c"
+#line 225 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::CIRCUMFLEXEQUAL, "^=")); goto again; }
-#line 753 "Tokenizer.cpp"
-yy91:
+#line 767 "Tokenizer.cpp"
+yy79:
 	++YYCURSOR;
-#line 131 "./tokenizer.re2c"
+#line 226 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::VBAREQUAL, "|=")); goto again; }
-#line 758 "Tokenizer.cpp"
-yy92:
+#line 772 "Tokenizer.cpp"
+yy80:
 	yych = *++YYCURSOR;
 	switch (yych) {
-		case '\n': goto yy93;
-		default: goto yy92;
+		case '\n': goto yy81;
+		default: goto yy80;
 	}
-yy93:
+yy81:
 	t2 = yyt1;
 	t3 = yyt2;
 	t1 = yyt1 - 1;
-#line 145 "./tokenizer.re2c"
+#line 240 "./tokenizer.re2c"
 	{
             processIndent(tokens, ind, nesting, (char*)t2, (char*)t3);
             YYCURSOR = t3;
             goto again;
         }
-#line 775 "Tokenizer.cpp"
-yy94:
-	yyaccept = 3;
-	yych = *(YYMARKER = ++YYCURSOR);
-	switch (yych) {
-		case '\n': goto yy63;
-		case '"': goto yy94;
-		default: goto yy59;
-	}
-yy95:
-	yyaccept = 3;
-	yych = *(YYMARKER = ++YYCURSOR);
-	goto yy104;
-yy96:
+#line 789 "Tokenizer.cpp"
+yy82:
 	++YYCURSOR;
-#line 133 "./tokenizer.re2c"
+#line 228 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::DOUBLESTAREQUAL, "**=")); goto again; }
-#line 792 "Tokenizer.cpp"
-yy97:
+#line 794 "Tokenizer.cpp"
+yy83:
 	++YYCURSOR;
-#line 134 "./tokenizer.re2c"
+#line 229 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::ELLIPSIS, "...")); goto again; }
-#line 797 "Tokenizer.cpp"
-yy98:
+#line 799 "Tokenizer.cpp"
+yy84:
 	++YYCURSOR;
-#line 135 "./tokenizer.re2c"
+#line 230 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::DOUBLESLASHEQUAL, "//=")); goto again; }
-#line 802 "Tokenizer.cpp"
-yy99:
+#line 804 "Tokenizer.cpp"
+yy85:
 	++YYCURSOR;
-#line 136 "./tokenizer.re2c"
+#line 231 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::LEFTSHIFTEQUAL, "<<=")); goto again; }
-#line 807 "Tokenizer.cpp"
-yy100:
+#line 809 "Tokenizer.cpp"
+yy86:
 	++YYCURSOR;
-#line 137 "./tokenizer.re2c"
+#line 232 "./tokenizer.re2c"
 	{ tokens.push_back(Token(Token::Type::RIGHTSHIFTEQUAL, ">>=")); goto again; }
-#line 812 "Tokenizer.cpp"
-yy101:
-	yych = *++YYCURSOR;
-	switch (yych) {
-		case '\n':
-		case '.': goto yy101;
-		case '"': goto yy105;
-		default: goto yy61;
-	}
-yy102:
-	yyaccept = 3;
-	yych = *(YYMARKER = ++YYCURSOR);
-	switch (yych) {
-		case '\n': goto yy63;
-		case '"': goto yy106;
-		default: goto yy59;
-	}
-yy103:
-	yych = *++YYCURSOR;
-yy104:
-	switch (yych) {
-		case '\n': goto yy101;
-		case '"': goto yy102;
-		case '.': goto yy103;
-		default: goto yy59;
-	}
-yy105:
-	yych = *++YYCURSOR;
-	switch (yych) {
-		case '"': goto yy107;
-		default: goto yy61;
-	}
-yy106:
-	yyaccept = 3;
-	yych = *(YYMARKER = ++YYCURSOR);
-	switch (yych) {
-		case '\n': goto yy63;
-		case '"': goto yy108;
-		default: goto yy59;
-	}
-yy107:
-	yych = *++YYCURSOR;
-	switch (yych) {
-		case '"': goto yy110;
-		default: goto yy61;
-	}
-yy108:
-	yyaccept = 5;
-	yych = *(YYMARKER = ++YYCURSOR);
-	switch (yych) {
-		case '\n': goto yy109;
-		default: goto yy60;
-	}
-yy109:
-	t1 = yyt1;
-#line 153 "./tokenizer.re2c"
-	{
-            tokens.push_back(Token(Token::Type::STRING, string(t1, YYCURSOR - t1)));
-            goto again;
-        }
-#line 872 "Tokenizer.cpp"
-yy110:
-	++YYCURSOR;
-	goto yy109;
+#line 814 "Tokenizer.cpp"
 }
-#line 177 "./tokenizer.re2c"
+#line 261 "./tokenizer.re2c"
 
 done:
+   stamp();
    return tokens;
 }
@@ -11,14 +11,16 @@ public:
     vector<Token> tokenize(const string& input);
     int mark() { return p; }
     void reset(int p) { this->p = p; }
-    Token peek() {
+    // valid until the tokens change
+    const Token& peek() {
+        static const Token end(Token::Type::ENDMARKER);
         if (p < tokens.size()) {
             return tokens[p];
         } else {
-            return Token(Token::Type::ENDMARKER);
+            return end;
         }
     }
-    Token next() {
+    const Token& next() {
         p++;
         return peek();
     }
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "GrammarProfiler.h"
+#include "Logger.h"
+#include "Tokenizer.h"
+
+// Parser tracing is only compiled in with PYSER_TRACE (on by default in
+// Debug builds). Otherwise the macros expand to nothing and their arguments
+// are never evaluated. When compiled in, output still needs
+// Logger::level == DEBUG, and arguments are only evaluated then.
+#ifdef PYSER_TRACE
+
+// Logs entering and leaving a grammar rule together with the tokens it
+// covered. Rules reset to where they started when they give up, so one that
+// leaves without moving the cursor is reported as failed.
+class RuleTrace {
+public:
+    RuleTrace(Tokenizer& tokenizer, const char* rule)
+        : tokenizer(tokenizer), rule(rule), start(tokenizer.mark()) {
+        if (Logger::level <= LogLevel::DEBUG) {
+            Logger::debug("%*s> %s @%d %s\n", depth * 2, "", rule, start,
+                          tokenizer.peek().toString().c_str());
+        }
+        depth++;
+    }
+
+    ~RuleTrace() {
+        depth--;
+        if (Logger::level <= LogLevel::DEBUG) {
+            int end = tokenizer.mark();
+            Logger::debug("%*s< %s @%d..%d %s\n", depth * 2, "", rule, start,
+                          end, end > start ? "ok" : "fail");
+        }
+    }
+
+private:
+    Tokenizer& tokenizer;
+    const char* rule;
+    int start;
+    static inline thread_local int depth = 0;
+};
+
+#define PYSER_TRACE_RULE(name) RuleTrace pyserRuleTrace(tokenizer, name)
+#define PYSER_DEBUG(...)                                                       \
+    do {                                                                       \
+        if (Logger::level <= LogLevel::DEBUG) {                                \
+            Logger::debug(__VA_ARGS__);                                        \
+        }                                                                      \
+    } while (0)
+
+#else
+
+#define PYSER_TRACE_RULE(name) ((void)0)
+#define PYSER_DEBUG(...) ((void)0)
+
+#endif
+
+// The grammar profiler is compiled in with PYSER_PROFILE and switched on by
+// GrammarProfiler::enable().
+#ifdef PYSER_PROFILE
+
+#define PYSER_PROFILE_RULE(name)                                               \
+    static const int pyserRuleId = GrammarProfiler::rule(name);                \
+    RuleProfile<Tokenizer> pyserRuleProfile(tokenizer, pyserRuleId)
+#define PYSER_PROFILE_RESET(tokens) GrammarProfiler::rewind(tokens)
+
+#else
+
+#define PYSER_PROFILE_RULE(name) ((void)0)
+#define PYSER_PROFILE_RESET(tokens) ((void)0)
+
+#endif
+
+// Placed at the entry of every grammar rule. The rule fails right away once
+// the parser has hit one of its ParseLimits.
+#define PYSER_RULE(name)                                                       \
+    PYSER_TRACE_RULE(name);                                                    \
+    PYSER_PROFILE_RULE(name);                                                  \
+    RuleDepth pyserRuleDepth(depth);                                           \
+    if (!enterRule()) {                                                        \
+        return {};                                                             \
+    }                                                                          \
+    ((void)0)
@@ -0,0 +1,92 @@
+#include "TraceEvents.h"
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using std::shared_ptr;
+using std::vector;
+
+namespace {
+
+struct Event {
+    const char* name;
+    double start;
+    double duration;
+    string file;
+    uint64_t bytes;
+};
+
+struct ThreadEvents {
+    int tid;
+    vector<Event> events;
+};
+
+std::mutex threadsMutex;
+vector<shared_ptr<ThreadEvents>> threads;
+
+// Buffers outlive their threads, write() runs after the workers joined.
+ThreadEvents& local() {
+    thread_local shared_ptr<ThreadEvents> events;
+    if (!events) {
+        events = std::make_shared<ThreadEvents>();
+        std::lock_guard<std::mutex> lock(threadsMutex);
+        events->tid = int(threads.size()) + 1;
+        threads.push_back(events);
+    }
+    return *events;
+}
+
+void writeString(FILE* out, const string& s) {
+    fputc('"', out);
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') {
+            fputc('\\', out);
+            fputc(c, out);
+        } else if (c < 0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+} // namespace
+
+void TraceEvents::enable() {
+    epoch = std::chrono::steady_clock::now();
+    enabled = true;
+}
+
+void TraceEvents::record(const char* name, double start, double end,
+                         const string& file, uint64_t bytes) {
+    local().events.push_back({name, start, end - start, file, bytes});
+}
+
+bool TraceEvents::write(const string& path) {
+    FILE* out = fopen(path.c_str(), "w");
+    if (!out) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(threadsMutex);
+    fprintf(out, "{\"traceEvents\": [");
+    const char* sep = "\n";
+    for (const shared_ptr<ThreadEvents>& t : threads) {
+        fprintf(out,
+                "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+                "\"tid\": %d, \"args\": {\"name\": \"thread %d\"}}",
+                sep, t->tid, t->tid);
+        sep = ",\n";
+        for (const Event& e : t->events) {
+            fprintf(out,
+                    "%s{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, "
+                    "\"tid\": %d, \"ts\": %.3f, \"dur\": %.3f, "
+                    "\"args\": {\"file\": ",
+                    sep, e.name, t->tid, e.start, e.duration);
+            writeString(out, e.file);
+            fprintf(out, ", \"bytes\": %llu}}", (unsigned long long)e.bytes);
+        }
+    }
+    fprintf(out, "\n], \"displayTimeUnit\": \"ms\"}\n");
+    return fclose(out) == 0;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+using std::string;
+
+// Spans in the Chrome trace-event format, loadable in Perfetto and
+// chrome://tracing. Every thread records into its own buffer; the buffers
+// are only read by write(), once the threads are done.
+class TraceEvents {
+public:
+    static void enable();
+    // Records a complete span. `name` must be a string literal.
+    static void record(const char* name, double start, double end,
+                       const string& file, uint64_t bytes);
+    // Microseconds since enable().
+    static double now() {
+        return std::chrono::duration<double, std::micro>(
+                   std::chrono::steady_clock::now() - epoch)
+            .count();
+    }
+    static bool write(const string& path);
+
+public:
+    static inline bool enabled = false;
+    static inline std::chrono::steady_clock::time_point epoch;
+};
+
+// Records the enclosing scope as a span, if tracing is enabled.
+class TraceSpan {
+public:
+    TraceSpan(const char* name, const string& file, uint64_t bytes = 0)
+        : name(name), file(file), bytes(bytes),
+          start(TraceEvents::enabled ? TraceEvents::now() : 0) {}
+    ~TraceSpan() {
+        if (TraceEvents::enabled) {
+            TraceEvents::record(name, start, TraceEvents::now(), file, bytes);
+        }
+    }
+
+public:
+    const char* name;
+    const string& file;
+    // known only once the file is read, so it can be set afterwards
+    uint64_t bytes;
+
+private:
+    double start;
+};
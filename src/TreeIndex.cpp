@@ -0,0 +1,134 @@
+#include "TreeIndex.h"
+#include "RecursiveVisitor.h"
+#include <stdexcept>
+
+static bool isStatement(NodeKind kind) {
+    return kind >= NodeKind::FunctionDef && kind <= NodeKind::Continue;
+}
+
+static bool isScope(NodeKind kind) {
+    return kind == NodeKind::Module || kind == NodeKind::FunctionDef ||
+           kind == NodeKind::ClassDef || kind == NodeKind::Lambda;
+}
+
+// Numbers the nodes with an explicit stack, operator chains can be deeper
+// than the native one.
+void TreeIndex::build() {
+    built = true;
+    class Pending {
+    public:
+        ast* node;
+        uint32_t parent;
+        // number of the node once its subtree is done, NONE before
+        uint32_t leaving;
+    };
+    vector<Pending> stack{{&root, NONE, NONE}};
+    vector<ast*> kids;
+    uint32_t post = 0;
+    while (!stack.empty()) {
+        Pending p = stack.back();
+        stack.pop_back();
+        if (p.leaving != NONE) {
+            Entry& e = entries[p.leaving];
+            e.postorder = post++;
+            e.end = uint32_t(entries.size());
+            continue;
+        }
+
+        uint32_t id = uint32_t(entries.size());
+        numbers[p.node] = id;
+        Entry e{p.node, p.parent, 0, NONE, NONE, NONE, NONE};
+        if (p.parent != NONE) {
+            const Entry& parent = entries[p.parent];
+            e.depth = parent.depth + 1;
+            e.statement = parent.statement;
+            e.scope = isScope(parent.node->kind) ? p.parent : parent.scope;
+        }
+        if (isStatement(p.node->kind)) {
+            e.statement = id;
+        }
+        entries.push_back(e);
+
+        stack.push_back({p.node, p.parent, id});
+        kids.clear();
+        forEachChild(*p.node,
+                     [&](auto& child) { kids.push_back(child.get()); });
+        for (size_t i = kids.size(); i-- > 0;) {
+            stack.push_back({kids[i], id, NONE});
+        }
+    }
+}
+
+const TreeIndex::Entry& TreeIndex::entry(const ast& node) {
+    if (!built) {
+        build();
+    }
+    auto it = numbers.find(&node);
+    if (it == numbers.end()) {
+        throw std::out_of_range("node is not in the indexed tree");
+    }
+    return entries[it->second];
+}
+
+size_t TreeIndex::size() {
+    if (!built) {
+        build();
+    }
+    return entries.size();
+}
+
+bool TreeIndex::contains(const ast& node) {
+    if (!built) {
+        build();
+    }
+    return numbers.count(&node);
+}
+
+ast& TreeIndex::node(uint32_t preorder) {
+    if (!built) {
+        build();
+    }
+    return *entries.at(preorder).node;
+}
+
+uint32_t TreeIndex::preorder(const ast& node) {
+    return uint32_t(&entry(node) - entries.data());
+}
+
+uint32_t TreeIndex::postorder(const ast& node) { return entry(node).postorder; }
+
+uint32_t TreeIndex::depth(const ast& node) { return entry(node).depth; }
+
+ast* TreeIndex::parent(const ast& node) {
+    uint32_t p = entry(node).parent;
+    return p == NONE ? nullptr : entries[p].node;
+}
+
+bool TreeIndex::isAncestor(const ast& ancestor, const ast& node) {
+    uint32_t a = preorder(ancestor);
+    uint32_t n = preorder(node);
+    return a < n && n < entries[a].end;
+}
+
+stmt* TreeIndex::enclosingStatement(const ast& node) {
+    uint32_t s = entry(node).statement;
+    return s == NONE ? nullptr : static_cast<stmt*>(entries[s].node);
+}
+
+ast* TreeIndex::enclosingScope(const ast& node) {
+    uint32_t s = entry(node).scope;
+    return s == NONE ? nullptr : entries[s].node;
+}
+
+ast* TreeIndex::firstChild(const ast& node) {
+    uint32_t n = preorder(node);
+    return entries[n].end > n + 1 ? entries[n + 1].node : nullptr;
+}
+
+ast* TreeIndex::nextSibling(const ast& node) {
+    const Entry& e = entry(node);
+    if (e.parent == NONE || e.end >= entries[e.parent].end) {
+        return nullptr;
+    }
+    return entries[e.end].node;
+}
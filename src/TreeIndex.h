@@ -0,0 +1,69 @@
+#pragma once
+
+#include "AST.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+using std::unordered_map;
+using std::vector;
+
+// Navigation over a parsed tree that the nodes, pointing only downward,
+// cannot answer themselves: parents, depths, preorder and postorder
+// numbers, ancestry, enclosing statements and scopes, siblings. Built on
+// the first query with one walk of the tree, after which every query is
+// O(1). Stale once the tree changes; not safe to query from several threads
+// before it is built.
+class TreeIndex {
+public:
+    explicit TreeIndex(ast& root): root(root) {}
+
+    size_t size();
+    bool contains(const ast& node);
+    // Node with the given preorder number, the root being 0.
+    ast& node(uint32_t preorder);
+
+    uint32_t preorder(const ast& node);
+    uint32_t postorder(const ast& node);
+    // 0 for the root
+    uint32_t depth(const ast& node);
+
+    // nullptr for the root
+    ast* parent(const ast& node);
+    // Whether `ancestor` is a proper ancestor of `node`.
+    bool isAncestor(const ast& ancestor, const ast& node);
+    // Innermost statement containing the node, the node itself if it is
+    // one; nullptr outside statements.
+    stmt* enclosingStatement(const ast& node);
+    // Innermost Module, FunctionDef, ClassDef or Lambda strictly
+    // containing the node.
+    ast* enclosingScope(const ast& node);
+
+    ast* firstChild(const ast& node);
+    ast* nextSibling(const ast& node);
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    class Entry {
+    public:
+        ast* node;
+        uint32_t parent;
+        uint32_t depth;
+        uint32_t postorder;
+        // preorder number past the last node of the subtree
+        uint32_t end;
+        uint32_t statement;
+        uint32_t scope;
+    };
+
+    void build();
+    const Entry& entry(const ast& node);
+
+private:
+    ast& root;
+    bool built = false;
+    // by preorder number
+    vector<Entry> entries;
+    unordered_map<const ast*, uint32_t> numbers;
+};
@@ -0,0 +1,140 @@
+#include "WorkStealingPool.h"
+#include <algorithm>
+
+static thread_local unsigned currentWorker = 0;
+
+unsigned WorkStealingPool::worker() { return currentWorker; }
+
+WorkStealingPool::WorkStealingPool(unsigned n) {
+    if (n == 0) {
+        n = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned i = 0; i < n; i++) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (unsigned i = 1; i < n; i++) {
+        threads.emplace_back([this, i] { work(i); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(batchMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& t : threads) {
+        t.join();
+    }
+}
+
+void WorkStealingPool::run(size_t count,
+                           const std::function<void(size_t)>& task) {
+    start(count, task, false);
+}
+
+void WorkStealingPool::runInOrder(size_t count,
+                                  const std::function<void(size_t)>& task) {
+    start(count, task, true);
+}
+
+void WorkStealingPool::start(size_t count,
+                             const std::function<void(size_t)>& task,
+                             bool ordered) {
+    if (count == 0) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(batchMutex);
+        current = &task;
+        inOrder = ordered;
+        error = nullptr;
+        remaining = count;
+        size_t n = queues.size();
+        for (size_t q = 0; q < n; q++) {
+            std::lock_guard<std::mutex> queueLock(queues[q]->mutex);
+            if (inOrder) {
+                for (size_t i = q; i < count; i += n) {
+                    queues[q]->tasks.push_back(i);
+                }
+                continue;
+            }
+            // contiguous ranges, neighbouring subtrees tend to share cache
+            // lines
+            for (size_t i = count * q / n; i < count * (q + 1) / n; i++) {
+                queues[q]->tasks.push_back(i);
+            }
+        }
+        batch++;
+    }
+    wake.notify_all();
+    drain(0);
+
+    std::unique_lock<std::mutex> lock(batchMutex);
+    finished.wait(lock, [this] { return remaining == 0; });
+    current = nullptr;
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void WorkStealingPool::work(unsigned self) {
+    uint64_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(batchMutex);
+            wake.wait(lock, [&] { return stopping || batch != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = batch;
+        }
+        drain(self);
+    }
+}
+
+void WorkStealingPool::drain(unsigned self) {
+    currentWorker = self;
+    size_t task;
+    while (take(self, task)) {
+        try {
+            (*current)(task);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(batchMutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+        if (--remaining == 0) {
+            std::lock_guard<std::mutex> lock(batchMutex);
+            finished.notify_all();
+        }
+    }
+}
+
+bool WorkStealingPool::take(unsigned self, size_t& task) {
+    {
+        Queue& own = *queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            if (inOrder) {
+                task = own.tasks.front();
+                own.tasks.pop_front();
+            } else {
+                task = own.tasks.back();
+                own.tasks.pop_back();
+            }
+            return true;
+        }
+    }
+    for (size_t i = 1; i < queues.size(); i++) {
+        Queue& victim = *queues[(self + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using std::unique_ptr;
+using std::vector;
+
+// Threads that run batches of independent tasks. Each thread takes tasks
+// from the back of its own deque and, once that is empty, steals from the
+// front of the others', so tasks of uneven size even out across threads.
+class WorkStealingPool {
+public:
+    // 0 threads means one per core; the thread calling run() works too.
+    explicit WorkStealingPool(unsigned threads = 0);
+    ~WorkStealingPool();
+
+    unsigned size() const { return unsigned(queues.size()); }
+
+    // Calls task(i) for every i < count and returns once all are done,
+    // rethrowing the first exception a task threw. One batch at a time.
+    void run(size_t count, const std::function<void(size_t)>& task);
+    // Like run(), the tasks being started about in the order of their
+    // index, for results consumed in that order: few are kept waiting for
+    // an earlier one.
+    void runInOrder(size_t count, const std::function<void(size_t)>& task);
+
+    // Number of the thread running the current task, below size(), 0 being
+    // the caller of run(). For state kept per thread, such as a parser.
+    static unsigned worker();
+
+private:
+    class Queue {
+    public:
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    void start(size_t count, const std::function<void(size_t)>& task,
+               bool inOrder);
+    void work(unsigned self);
+    void drain(unsigned self);
+    bool take(unsigned self, size_t& task);
+
+private:
+    // queues[0] belongs to the thread calling run()
+    vector<unique_ptr<Queue>> queues;
+    vector<std::thread> threads;
+
+    std::mutex batchMutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    uint64_t batch = 0;
+    bool stopping = false;
+    const std::function<void(size_t)>* current = nullptr;
+    // tasks dealt out in turn and taken from the front, see runInOrder()
+    bool inOrder = false;
+    std::atomic<size_t> remaining{0};
+    std::exception_ptr error;
+};
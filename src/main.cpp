@@ -1,6 +1,15 @@
+#include "AstStats.h"
+#include "ConstantFolding.h"
 #include "Parser.h"
 #include "PrettyPrinter.h"
+#include "Queries.h"
+#include "GrammarProfiler.h"
+#include "Lint.h"
 #include "Logger.h"
+#include "RunStats.h"
+#include "SourceFiles.h"
+#include "TraceEvents.h"
+#include "WorkStealingPool.h"
 
 #include <cmath>
 #include <cstdio>
@@ -8,27 +17,296 @@
 #include <sstream>
 #include <memory>
 #include <string>
+#include <thread>
 
 using namespace std;
 
+struct FileResult {
+    string output;
+    // diagnostics, already formatted
+    string errors;
+    bool unreadable = false;
+    RunStats stats;
+};
+
+struct Options {
+    bool countNodes = false;
+    bool perf = false;
+    // decoded string literals instead of the tree
+    bool strings = false;
+    bool foldConstants = false;
+    // lint findings instead of the tree
+    bool lint = false;
+    // where the lint of a single input spreads its subtrees, null for none
+    WorkStealingPool* lintPool = nullptr;
+    // --node-at LINE:COL, instead of the tree; 0 for none
+    uint32_t nodeAtLine = 0;
+    uint32_t nodeAtColumn = 0;
+    // --nodes-in LINE:COL-LINE:COL, both lines 0 for none
+    uint32_t nodesFrom[2] = {0, 0};
+    uint32_t nodesTo[2] = {0, 0};
+    ParseLimits limits;
+    // per file, 0 for none
+    long timeoutMs = 0;
+};
+
+// Reads, parses and prints one input, "-" being stdin.
+static void processFile(const string& path, const Options& options,
+                        FileResult& r) {
+    RunStats& run = r.stats;
+    run.perf = options.perf;
+    AllocCounts allocsBefore = AllocStats::counts();
+    string input;
+    bool readOk = true;
+    {
+        TraceSpan span("read", path);
+        run.phase("read", [&] {
+            if (path == "-") {
+                input = string{std::istreambuf_iterator<char>{std::cin},
+                               std::istreambuf_iterator<char>{}};
+                return;
+            }
+            readOk = readFile(path, input);
+        });
+        span.bytes = input.size();
+    }
+    if (!readOk) {
+        r.unreadable = true;
+        return;
+    }
+    run.bytes = input.size();
+
+    auto parser = make_unique<Parser>();
+    {
+        TraceSpan span("tokenize", path, input.size());
+        run.phase("tokenize", [&] { run.tokens = parser->tokenize(input); });
+    }
+    ParseResult result;
+    {
+        TraceSpan span("parse", path, input.size());
+        ParseLimits limits = options.limits;
+        if (options.timeoutMs > 0) {
+            limits.deadline = std::chrono::steady_clock::now() +
+                              std::chrono::milliseconds(options.timeoutMs);
+        }
+        run.phase("parse", [&] { result = parser->parseTokens(limits); });
+    }
+    const char* prefix = path == "-" ? "" : path.c_str();
+    const char* sep = path == "-" ? "" : ": ";
+    if (!result.ok()) {
+        for (const Diagnostic& d : result.diagnostics) {
+            char buf[64];
+            snprintf(buf, sizeof(buf), " at %d:%d\n", d.line, d.col + 1);
+            r.errors += string(prefix) + sep + "error: " + d.message + buf;
+        }
+        return;
+    }
+    if (options.foldConstants) {
+        run.phase("fold", [&] { foldConstants(*result.module); });
+    }
+    if (options.countNodes) {
+        NodeCounter counter;
+        result.module->accept(counter);
+        run.nodes = counter.total;
+        run.nodeClasses = move(counter.classes);
+    }
+    {
+        TraceSpan span("emit", path, input.size());
+        run.phase("print", [&] {
+            if (options.strings) {
+                r.output = listStrings(*result.module, input);
+                return;
+            }
+            if (options.nodesFrom[0]) {
+                r.output = describeNodesIn(*result.module, input,
+                                           options.nodesFrom, options.nodesTo);
+                return;
+            }
+            if (options.nodeAtLine) {
+                r.output = describeNodeAt(*result.module, input,
+                                          options.nodeAtLine,
+                                          options.nodeAtColumn);
+                return;
+            }
+            if (options.lint) {
+                SourceLines lines(input);
+                for (const LintFinding& f :
+                     lint(*result.module, options.lintPool)) {
+                    char buf[64];
+                    snprintf(buf, sizeof(buf), " at %u:%u\n",
+                             lines.line(f.offset), lines.column(f.offset));
+                    r.output += string(prefix) + sep + "warning: " +
+                                f.message + buf;
+                }
+                return;
+            }
+            PrettyPrinter pprint0;
+            result.module->accept(pprint0);
+            r.output = move(pprint0.ctx.s);
+            r.output += '\n';
+        });
+    }
+    run.phase("teardown", [&] {
+        result.module.reset();
+        parser.reset();
+    });
+    run.allocs = AllocStats::counts() - allocsBefore;
+}
+
 int main(int argc, char* argv[]) {
-    string input = string{std::istreambuf_iterator<char>{std::cin},
-                          std::istreambuf_iterator<char>{}};
-    Parser parser;
+    bool profileGrammar = false;
+    bool stats = false;
+    bool footprint = false;
+    Options options;
+    options.limits.maxDepth = ParseLimits::safeDepth;
+    unsigned jobs = 1;
+    string traceEvents;
+    vector<string> paths;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--debug") {
+            // rule traces need a build with PYSER_TRACE
+            Logger::level = LogLevel::DEBUG;
+        } else if (arg == "--log-file" && i + 1 < argc) {
+            FILE* sink = fopen(argv[++i], "w");
+            if (!sink) {
+                fprintf(stderr, "cannot open %s\n", argv[i]);
+                return 2;
+            }
+            Logger::setSink(sink);
+        } else if (arg == "--profile-grammar") {
+#ifndef PYSER_PROFILE
+            fprintf(stderr, "--profile-grammar needs a build with "
+                            "-DPYSER_PROFILE=ON\n");
+            return 2;
+#endif
+            profileGrammar = true;
+        } else if (arg == "--stats") {
+            stats = true;
+        } else if (arg == "--perf-counters") {
+            // hardware counters per phase in the --stats report
+            stats = true;
+            options.perf = true;
+        } else if (arg == "--strings") {
+            options.strings = true;
+        } else if (arg == "--fold-constants") {
+            options.foldConstants = true;
+        } else if (arg == "--lint") {
+            options.lint = true;
+        } else if (arg == "--node-at" && i + 1 < argc) {
+            if (sscanf(argv[++i], "%u:%u", &options.nodeAtLine,
+                       &options.nodeAtColumn) != 2 ||
+                !options.nodeAtLine || !options.nodeAtColumn) {
+                fprintf(stderr, "--node-at takes LINE:COL, from 1\n");
+                return 2;
+            }
+        } else if (arg == "--nodes-in" && i + 1 < argc) {
+            uint32_t* from = options.nodesFrom;
+            uint32_t* to = options.nodesTo;
+            if (sscanf(argv[++i], "%u:%u-%u:%u", &from[0], &from[1], &to[0],
+                       &to[1]) != 4 ||
+                !from[0] || !from[1] || !to[0] || !to[1]) {
+                fprintf(stderr, "--nodes-in takes LINE:COL-LINE:COL, from 1\n");
+                return 2;
+            }
+        } else if (arg == "--ast-footprint") {
+            footprint = true;
+        } else if ((arg == "--jobs" || arg == "-j") && i + 1 < argc) {
+            int n = atoi(argv[++i]);
+            jobs = n > 0 ? unsigned(n) : std::thread::hardware_concurrency();
+        } else if (arg == "--timeout-ms" && i + 1 < argc) {
+            options.timeoutMs = atol(argv[++i]);
+        } else if (arg == "--max-steps" && i + 1 < argc) {
+            options.limits.maxSteps = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--max-depth" && i + 1 < argc) {
+            options.limits.maxDepth = atoi(argv[++i]);
+        } else if (arg == "--trace-events" && i + 1 < argc) {
+            traceEvents = argv[++i];
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            fprintf(stderr, "unknown option: %s\n", argv[i]);
+            return 2;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.empty()) {
+        paths.push_back("-");
+    }
+    // the grammar profile is kept per thread, so it needs everything on one
+    if (profileGrammar) {
+        jobs = 1;
+    }
+    // the threads go to the subtrees of a single input rather than idle
+    unique_ptr<WorkStealingPool> lintPool;
+    if (options.lint && paths.size() == 1 && jobs > 1) {
+        lintPool = make_unique<WorkStealingPool>(jobs);
+        options.lintPool = lintPool.get();
+    }
+    jobs = std::min<size_t>(jobs, paths.size());
+
+    if (traceEvents.size()) {
+        TraceEvents::enable();
+    }
+    if (profileGrammar) {
+        GrammarProfiler::enable();
+    }
+    if (options.perf && !PerfCounters::local().available()) {
+        fprintf(stderr, "perf counters unavailable: %s\n",
+                PerfCounters::local().error.c_str());
+        options.perf = false;
+    }
+    options.countNodes = stats || footprint;
 
-    // Logger::level = LogLevel::DEBUG;
+    vector<FileResult> results(paths.size());
+    auto start = std::chrono::steady_clock::now();
+    if (jobs == 1) {
+        for (size_t i = 0; i < paths.size(); i++) {
+            processFile(paths[i], options, results[i]);
+        }
+    } else {
+        WorkStealingPool pool(jobs);
+        pool.run(paths.size(), [&](size_t i) {
+            processFile(paths[i], options, results[i]);
+        });
+    }
+    std::chrono::duration<double> wall =
+        std::chrono::steady_clock::now() - start;
 
-    unique_ptr<ast> t = nullptr;
-    try {
-        t = parser.parse(input);
-    } catch (runtime_error& e) {
-        printf("error: %s\n", e.what());
-        return 1;
+    if (profileGrammar) {
+        GrammarProfiler::report(stderr);
+    }
+    int status = 0;
+    RunStats total;
+    for (size_t i = 0; i < results.size(); i++) {
+        FileResult& r = results[i];
+        if (r.unreadable) {
+            fprintf(stderr, "cannot open %s\n", paths[i].c_str());
+            status = 1;
+        } else if (r.errors.size()) {
+            fputs(r.errors.c_str(), stdout);
+            status = 1;
+        }
+        fputs(r.output.c_str(), stdout);
+        r.stats.files = 1;
+        r.stats.failedFiles = r.unreadable || r.errors.size();
+        total.merge(r.stats);
+    }
+    total.wallSeconds = wall.count();
+    total.jobs = jobs;
+    total.perf = options.perf;
+    // broken inputs are part of what was measured, the report is written
+    // whatever the status
+    if (stats) {
+        fflush(stdout);
+        total.writeJson(stderr);
+    }
+    if (footprint) {
+        fflush(stdout);
+        writeFootprint(stderr, total.nodeClasses);
     }
-    PrettyPrinter pprint0;
-    if (t) {
-        t->accept(pprint0);
-        printf("%s\n", pprint0.ctx.s.c_str());
+    if (traceEvents.size() && !TraceEvents::write(traceEvents)) {
+        fprintf(stderr, "cannot write %s\n", traceEvents.c_str());
+        return 2;
     }
-    return 0;
+    return status;
 }
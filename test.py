@@ -52,9 +52,37 @@ def test():
             succ += 1
         else:
             print(f"{str(file):<48} failed")
-    if succ != total:
-        sys.exit(-1)
-        
+    return succ == total
+
+
+# Inputs next to what pyser should print for them: diagnostics for the
+# broken ones in test/errors, other reports than the tree in test/outputs.
+# A first line "# pyser: ARGS" passes ARGS on the command line.
+def test_outputs(directory):
+    p = Path(directory)
+    files = sorted(p.glob("*.py"))
+    succ = 0
+    for file in files:
+        with open(file) as fp:
+            first = fp.readline()
+        args = ""
+        if first.startswith("# pyser:"):
+            args = first[len("# pyser:"):].strip()
+        script = f"cat {file} | {pyser} {args}"
+        out = os.popen(script).read()
+        with open(file.with_suffix(".out")) as fp:
+            ans = fp.read()
+        if out == ans:
+            print(f"{str(file):<48} succ")
+            succ += 1
+        else:
+            print(f"{str(file):<48} failed")
+    return succ == len(files)
+
 
 if __name__ == "__main__":
-    test()
+    ok = test()
+    ok = test_outputs("./test/errors") and ok
+    ok = test_outputs("./test/outputs") and ok
+    if not ok:
+        sys.exit(-1)
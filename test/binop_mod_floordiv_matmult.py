@@ -0,0 +1,2 @@
+a % b // c
+x = a @ b
@@ -0,0 +1,3 @@
+while a b:
+  x
+  y = = 1
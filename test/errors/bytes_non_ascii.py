@@ -0,0 +1,2 @@
+x = b'café'
+y = b'ok'
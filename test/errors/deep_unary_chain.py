@@ -0,0 +1,3 @@
+# pyser: --max-depth 50
+x = ----------------------------------------------------------------------------------------------------1
+y = 1
@@ -0,0 +1,4 @@
+x = 1 +
+y = a <
+z = a and
+w = -
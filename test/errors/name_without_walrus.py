@@ -0,0 +1,2 @@
+while a b:
+    pass
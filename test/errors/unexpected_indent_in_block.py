@@ -0,0 +1,3 @@
+while a:
+  x
+    y
@@ -0,0 +1,2 @@
+x = 'abc
+y = 1
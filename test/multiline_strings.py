@@ -0,0 +1,11 @@
+doc = """first line
+  second "line" with ""quotes""
+"""
+single = '''it's
+'quoted' \''' still open
+'''
+continued = 'one \
+two'
+raw = r'\'' + r"\"" + r'''a\'''b'''
+empty = '' + "" + '''''' + """"""
+after = 'x'
@@ -0,0 +1,19 @@
+# pyser: --strings
+plain = 'single' + "double"
+escapes = 'tab\there\nnew\\line \'q\' \"d\" \a\b\f\v end'
+octal = '\0 \7 \101\1012 \777'
+hex_ = '\x41\x7f\xe9'
+unicode = 'é中 \U0001F600 café'
+raw = r'\n\x41\\' + R"é"
+unknown = '\q \8'
+literal = 'é 中'
+u = u'é'
+triple = '''a\tb "q" 'q' '''
+b1 = b'\x00\xff\x41 \101 \\ \n'
+b2 = B"\N{BULLET} \q \u00e9"
+b3 = rb'\x41\n' + Br"\\" + bR'\q'
+continued = 'one \
+two'
+lines = '''a
+\tb\
+c'''
@@ -0,0 +1,15 @@
+# pyser: --fold-constants
+a = 1 + 2 * 3 - 4
+b = -5 + +6 - ~7
+c = 2 ** 10 - 2 ** 0
+d = 7 // 2 + -7 // 2 + 7 // -2
+e = 7 % 3 + -7 % 3 + 7 % -3
+f = 1 << 4 | 1
+g = -17 >> 2
+i = 12 & 10 ^ 3
+j = x + 1 * 2
+k = 1 + 2 + x
+kept = 1 / 2 + 2 ** -1 + 1 // 0 + 1 % 0 + 1 << -1
+big = 9223372036854775807 + 1
+small = -9223372036854775807 - 1
+huge = 2 ** 64
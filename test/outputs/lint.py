@@ -0,0 +1,24 @@
+# pyser: --lint
+a = b == None
+a = None != b
+a = b is None
+a = b is 1
+a = 'x' is not b
+a = 0 < b == None
+a = a
+a = b = a
+a = b
+while a:
+    a = a + 1
+while a:
+    while b:
+        while c:
+            while d:
+                while e:
+                    while f:
+                        while g:
+                            pass
+                    while h:
+                        pass
+while a:
+    pass
@@ -0,0 +1,144 @@
+# pyser: --lint -j 4
+a = b == None
+a = None != b
+a = b is None
+a = b is 1
+a = 'x' is not b
+a = 0 < b == None
+a = a
+a = b = a
+a = b
+while a:
+    a = a + 1
+while a:
+    while b:
+        while c:
+            while d:
+                while e:
+                    while f:
+                        while g:
+                            pass
+                    while h:
+                        pass
+while a:
+    pass
+v1 = w1 == None
+while v1:
+    v1 = v1
+v2 = w2 == None
+while v2:
+    v2 = v2
+v3 = w3 == None
+while v3:
+    v3 = v3
+v4 = w4 == None
+while v4:
+    v4 = v4
+v5 = w5 == None
+while v5:
+    v5 = v5
+v6 = w6 == None
+while v6:
+    v6 = v6
+v7 = w7 == None
+while v7:
+    v7 = v7
+v8 = w8 == None
+while v8:
+    v8 = v8
+v9 = w9 == None
+while v9:
+    v9 = v9
+v10 = w10 == None
+while v10:
+    v10 = v10
+v11 = w11 == None
+while v11:
+    v11 = v11
+v12 = w12 == None
+while v12:
+    v12 = v12
+v13 = w13 == None
+while v13:
+    v13 = v13
+v14 = w14 == None
+while v14:
+    v14 = v14
+v15 = w15 == None
+while v15:
+    v15 = v15
+v16 = w16 == None
+while v16:
+    v16 = v16
+v17 = w17 == None
+while v17:
+    v17 = v17
+v18 = w18 == None
+while v18:
+    v18 = v18
+v19 = w19 == None
+while v19:
+    v19 = v19
+v20 = w20 == None
+while v20:
+    v20 = v20
+v21 = w21 == None
+while v21:
+    v21 = v21
+v22 = w22 == None
+while v22:
+    v22 = v22
+v23 = w23 == None
+while v23:
+    v23 = v23
+v24 = w24 == None
+while v24:
+    v24 = v24
+v25 = w25 == None
+while v25:
+    v25 = v25
+v26 = w26 == None
+while v26:
+    v26 = v26
+v27 = w27 == None
+while v27:
+    v27 = v27
+v28 = w28 == None
+while v28:
+    v28 = v28
+v29 = w29 == None
+while v29:
+    v29 = v29
+v30 = w30 == None
+while v30:
+    v30 = v30
+v31 = w31 == None
+while v31:
+    v31 = v31
+v32 = w32 == None
+while v32:
+    v32 = v32
+v33 = w33 == None
+while v33:
+    v33 = v33
+v34 = w34 == None
+while v34:
+    v34 = v34
+v35 = w35 == None
+while v35:
+    v35 = v35
+v36 = w36 == None
+while v36:
+    v36 = v36
+v37 = w37 == None
+while v37:
+    v37 = v37
+v38 = w38 == None
+while v38:
+    v38 = v38
+v39 = w39 == None
+while v39:
+    v39 = v39
+v40 = w40 == None
+while v40:
+    v40 = v40
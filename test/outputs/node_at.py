@@ -0,0 +1,6 @@
+# pyser: --node-at 5:20
+x = 1
+while a.b:
+    while c:
+        y = a[b + c.d.e] * 2
+z = x
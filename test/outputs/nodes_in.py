@@ -0,0 +1,6 @@
+# pyser: --nodes-in 4:9-5:8
+x = 1
+while a.b:
+    y = a[b + c.d] * 2
+    z = x
+w = y
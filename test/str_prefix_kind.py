@@ -0,0 +1,3 @@
+a = u'abc'
+b = rb"\d+"
+c = B'x'
@@ -0,0 +1,4 @@
+x = 'a' + 'b'
+y = "c" == "d"
+z = """e""" + """f"""
+w = 'g\'h' + 'i'
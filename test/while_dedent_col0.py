@@ -0,0 +1,6 @@
+while a:
+    while b:
+        x = 1
+y = 2
+while c:
+    z = 3
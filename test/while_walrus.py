@@ -0,0 +1,2 @@
+while n := 10:
+    pass